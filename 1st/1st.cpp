@@ -1,167 +1,85 @@
 #include "bitmap_manager.hpp"
+#include "gray_image.hpp"
+#include "threshold.hpp"
+#include "histogram.hpp"
 
 using namespace std;
 
 /**
  * @fn カラー画像をグレイスケール画像へ変換
+ * @details 0.3R + 0.59G + 0.11B を固定小数点で求める。変換とヒストグラムの集計は行を分けて並列に行う
  * @param bmp ビットマップマネージャー
+ * @param gray 出力先のグレイスケール画像
  * @count ヒストグラム用の配列 [0 256)
  */
-void color2Grayscale(BitmapManager *bmp, int *count) {
-    //! 各色に乗ずる係数
-    const float c_r = 0.3;
-    const float c_g = 0.59;
-    const float c_b = 0.11;
-
-    //! 各画素の色を保存する変数
-    Color color;
-    //! カラー画素から生成したグレイスケールの値
-    int grayValue;
-
-    for (int row = 0; row < bmp->getHeight(); row++){
-        for (int col = 0; col < bmp->getWidth(); col++){
-            // カラー取得
-            color = bmp->getColor(row, col);
-
-            // 変換式によってグレースケールへ変換
-            grayValue = (int)(c_r * color.r + c_g * color.g + c_b * color.b);
-
-            // 求めたグレースケール値をセット
-            bmp->setColor(row, col, grayValue, grayValue, grayValue);
-
-            // ヒストグラム用にグレースケール値をカウント
-            count[grayValue]++;
-        }
-    }
+void color2Grayscale(BitmapManager *bmp, GrayImage *gray, int *count) {
+    gray->fromColor(*bmp, count);
 }
 
 /**
- * @fn ヒストグラムの最大値を求める
- * @detail gnuplotのy軸の範囲を決定
+ * @fn ヒストグラムを書き出す
+ * @details 既定ではhistgram/以下へCSV, JSON, BMPの図をプロセス内で書き出す。
+ *          gnuplotを指定した場合はgnuplotを起動してPNGの図を書き出す
+ * @param count ヒストグラム [0 256)
+ * @param img_name 画像の名前
+ * @param backend 出力先
  */
-int count_max(int *count){
-    auto temp_max = 0;
-
-    for (int i = 0; i < 256; i++) {
-        if (temp_max < count[i]) {
-            temp_max = count[i];
-        }
-    }
+void showHistgram(int *count, string img_name, HistogramBackend backend) {
+    //! 出力ファイル名 (拡張子なし)
+    string base = "./histgram/" + img_name + "_histgram";
 
-    return temp_max;
-}
-
-/**
- * @fn gnuplotを用いてヒストグラムを生成
- */
-void showHistgram(BitmapManager *bmp, int *count, string img_name) {
-    FILE *gp;
-    int i;
-
-    //! ヒストグラムの最大値 
-    auto max = count_max(count);
-
-    // gnuplot 起動・設定
-    gp = popen("gnuplot -persist", "w");  // パイプを開き、gnuplotの立ち上げ
-    //fprintf(gp, "set multiplot\n");  // マルチプロットモード
-    fprintf(gp, "set terminal png\n");
-    fprintf(gp, "set out \"./histgram/%s_histgram.png\"\n", img_name.c_str());
-    fprintf(gp, "set xrange [0:255]\n");  // 範囲の指定 x[0 255]
-    fprintf(gp, "set yrange [0:%d]\n", max + 500);  // 範囲の指定 y[0 ヒストグラムの最大値+1000]
-    fprintf(gp, "set xlabel \"Pixel Values\"\n");  // ラベル表示
-    fprintf(gp, "set ylabel \"Frequency\"\n");
-
-    // プロット
-    fprintf(gp, "plot '-' with lines linetype 1\n");
-    for (i = 0; i < 255; ++i) {
-        fprintf(gp, "%d\t%d\n", i, count[i]);
+    if (backend == HISTOGRAM_GNUPLOT) {
+        writeHistogramGnuplot(base + ".png", count);
+        return;
     }
-    fprintf(gp, "e\n");
 
-    // gnuplot 終了処理
-    // fprintf(gp, "set nomultiplot\n"); // マルチプロットモード終了
-    fprintf(gp, "exit\n"); // gnuplotの終了
-    fflush(gp);
-    pclose(gp); // パイプを閉じる
+    writeHistogramCsv(base + ".csv", count);
+    writeHistogramJson(base + ".json", count);
+    writeHistogramPlot(base + ".bmp", count);
 }
 
 /**
  * @fn 判別分析法を用いて画像を2値化
+ * @details しきい値は累積ヒストグラムからO(256)で求める (OtsuThreshold)
  */
-void applyBinarization(BitmapManager *bmp, int *hist) {
+void applyBinarization(GrayImage *img, int *hist) {
 
     // 判別分析法
+    OtsuThreshold otsu(hist);
     //! しきい値
-    int threshold = 0;
-    //! pixelNum1 * pixelNum2 * (ave1 - ave2)^2 の最大値
-    double max = 0.0;
-
-    for (int i = 0; i < 256; ++i){
-        int pixelNum1 = 0;  //! クラス1の画素数
-        int pixelNum2 = 0;  //! クラス2の画素数
-        long sum1 = 0;  //! クラス1の平均を出すための合計値
-        long sum2 = 0;  //! クラス2の平均を出すための合計値
-        double ave1 = 0.0;  //! クラス1の平均
-        double ave2 = 0.0;  //! クラス2の平均
-
-        // iまで クラス1へ格納
-        for (int j = 0; j <= i; ++j){
-            pixelNum1 += hist[j];
-            sum1 += j * hist[j];
-        }
-
-        // i以降 クラス2へ格納
-        for (int j = i + 1; j < 256; ++j){
-            pixelNum2 += hist[j];
-            sum2 += j * hist[j];
-        }
-
-        // 平均導出
-        if (pixelNum1)
-            ave1 = (double)sum1 / pixelNum1;
-
-        if (pixelNum2)
-            ave2 = (double)sum2 / pixelNum2;
-
-        // 分散導出
-        double tmp = ((double)pixelNum1 * pixelNum2 * (ave1 - ave2) * (ave1 - ave2));
-
-        // 最大値更新
-        if (tmp > max){
-            max = tmp;
-            threshold = i;
-        }
-    }
+    int threshold = otsu.getThreshold();
 
     cout << "threshold: " << threshold << endl;
 
-    /* tの値を使って2値化 */
-    for (int row = 0; row < bmp->getHeight(); row++){
-        for (int col = 0; col < bmp->getWidth(); col++){
-            // しきい値を下回れば0、上回れば255で書き込み
-            if (bmp->getColor(row, col).r < threshold)
-                bmp->setColor(row, col, 0, 0, 0);
-            else
-                bmp->setColor(row, col, 255, 255, 255);
-        }
-    }
+    /* tの値を使って2値化 (しきい値を下回れば0、上回れば255) */
+    applyThresholds(*img, vector<int>(1, threshold));
 }
 
 
 int main(int argc, char *argv[]) {
 
-    if (argc != 2){
-        cerr << "Usage ./prog filename(without .bmp)" << endl;
+    // --probe: ヘッダーのみを読み込み、画像情報を一覧表示
+    if (argc >= 2 && string(argv[1]) == "--probe")
+        return probeFiles(argc - 2, argv + 2);
+
+    if (argc < 2 || argc > 3 || (argc == 3 && string(argv[2]) != "builtin" && string(argv[2]) != "gnuplot")){
+        cerr << "Usage ./prog filename(without .bmp) [builtin|gnuplot]" << endl;
+        cerr << "      ./prog --probe file.bmp..." << endl;
         return -1;
     }
 
+    //! ヒストグラムの出力先 (既定はプロセス内で書き出す)
+    HistogramBackend backend = argc == 3 && string(argv[2]) == "gnuplot" ? HISTOGRAM_GNUPLOT : HISTOGRAM_BUILTIN;
+
     //! ファイル名
     string src_filename = "src/" + string(argv[1]) + ".bmp";
     string gray_filename = "dst/" + string(argv[1]) + "_gray.bmp";
     string binarization_filename = "dst/" + string(argv[1]) + "_binarization.bmp";
+    string multilevel_filename = "dst/" + string(argv[1]) + "_multilevel.bmp";
 
     // Bitmap
     BitmapManager bmp;
+    GrayImage gray, multilevel;
     // ヒストグラム用カウンタ
     int count[256] = {0};
 
@@ -170,15 +88,28 @@ int main(int argc, char *argv[]) {
     bmp.displayHeader();
 
     // グレースケール化
-    color2Grayscale(&bmp, count);
-    bmp.writeData(gray_filename);
+    color2Grayscale(&bmp, &gray, count);
+    gray.writeData(gray_filename);
 
     // ヒストグラム表示
-    showHistgram(&bmp, count, string(argv[1]));
+    showHistgram(count, string(argv[1]), backend);
+
+    // ヒストグラムから統計量を求める (画素は読み直さない)
+    HistogramStats stats(count);
+    cout << "mean: " << stats.getMean() << ", stddev: " << stats.getStdDev()
+         << ", min: " << stats.getMin() << ", max: " << stats.getMax()
+         << ", median: " << stats.getMedian() << ", entropy: " << stats.getEntropy() << endl;
+
+    // 多段階の判別分析法 (同じヒストグラムから3値化のしきい値を求める)
+    multilevel.copy(gray, true);
+    vector<int> thresholds = OtsuThreshold(count).getThresholds(2);
+    cout << "thresholds: " << thresholds[0] << ", " << thresholds[1] << endl;
+    applyThresholds(multilevel, thresholds);
+    multilevel.writeData(multilevel_filename, WRITE_RLE8);
 
     // 判別分析法の利用
-    applyBinarization(&bmp, count);
-    bmp.writeData(binarization_filename);
+    applyBinarization(&gray, count);
+    gray.writeData(binarization_filename, WRITE_1BIT);
 
     return 0;
 }
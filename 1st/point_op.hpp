@@ -0,0 +1,36 @@
+#ifndef POINT_OP_HPP
+#define POINT_OP_HPP
+
+#include <vector>
+#include "gray_image.hpp"
+
+/**
+ * @brief 画素ごとの変換 (点演算) を順につなげたもの
+ * @details 8bitの点演算は256要素の変換表で表せるため、演算を追加するたびに変換表を合成しておく。
+ *          何段つなげても、画像へは変換表を1回引くだけの走査で適用する (apply)。
+ *          例) PointOps().gamma(0.5).threshold(128).apply(img)
+ */
+class PointOps {
+    // フィールド定義
+    uint8_t table[256];  // これまでの演算を合成した変換表
+
+public:
+    // コンストラクタ
+    PointOps();  // 恒等変換
+
+    // メソッド定義 (いずれも自身を返し、続けて演算を追加できる)
+    PointOps &scale(double gain, double offset = 0.0);  // v * gain + offset (四捨五入して0〜255に収める)
+    PointOps &gamma(double gamma);  // 255 * (v / 255)^gamma
+    PointOps &invert();  // 255 - v
+    PointOps &threshold(int threshold);  // threshold未満は0、それ以外は255
+    PointOps &quantize(const std::vector<int> &thresholds);  // しきい値 (昇順) で多値化
+    PointOps &lookup(const uint8_t *next);  // 任意の変換表 [0 256)
+    PointOps &then(const PointOps &next);  // 別の演算列を続ける
+
+    const uint8_t *getTable() const;  // 合成した変換表 [0 256) を取得
+    void apply(GrayImage &img) const;  // 画像へ1回の走査で適用
+};
+
+void applyLookupTable(GrayImage &img, const uint8_t *table);  // 変換表で全画素を置き換える (行を分けて並列に処理)
+
+#endif // POINT_OP_HPP
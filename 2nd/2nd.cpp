@@ -1,176 +1,61 @@
 #include "bitmap_manager.hpp"
+#include "gray_image.hpp"
+#include "filter.hpp"
 
 using namespace std;
 
-/**
- * @fn クイックソート
- * @param first イテレータのはじめ
- * @param last イテレータの終わり
- */
-template< class T >
-void quick_sort(T first, T last) {
-    if (last - first <= 1) { return; }
-    T i = first, j = last - 1;
-    for (T pivot = first;; ++i, --j) {
-        while (*i < *pivot)  ++i;
-        while (*pivot < *j)  --j;
-        if (i >= j)  break;
-        iter_swap(i, j);
-    }
-    quick_sort(first, i);
-    quick_sort(j + 1, last);
-}
-
 /**
  * @fn カラー画像をグレイスケール画像へ変換
+ * @details 0.3R + 0.59G + 0.11B を固定小数点で求める。変換とヒストグラムの集計は行を分けて並列に行う
  * @param bmp ビットマップマネージャー
+ * @param gray 出力先のグレイスケール画像
  * @count ヒストグラム用の配列 [0 256)
  */
-void color2Grayscale(BitmapManager *bmp, int *count) {
-    //! 各色に乗ずる係数
-    const float c_r = 0.3;
-    const float c_g = 0.59;
-    const float c_b = 0.11;
-
-    //! 各画素の色を保存する変数
-    Color color;
-    //! カラー画素から生成したグレイスケールの値
-    int grayValue;
-
-    for (int row = 0; row < bmp->getHeight(); row++){
-        for (int col = 0; col < bmp->getWidth(); col++){
-            // カラー取得
-            color = bmp->getColor(row, col);
-
-            // 変換式によってグレースケールへ変換
-            grayValue = (int)(c_r * color.r + c_g * color.g + c_b * color.b);
-
-            // 求めたグレースケール値をセット
-            bmp->setColor(row, col, grayValue, grayValue, grayValue);
-
-            // ヒストグラム用にグレースケール値をカウント
-            count[grayValue]++;
-        }
-    }
+void color2Grayscale(BitmapManager *bmp, GrayImage *gray, int *count) {
+    gray->fromColor(*bmp, count);
 }
 
 /**
- * @fn 3x3 平均フィルタを適用
+ * @fn 平均フィルタを適用
+ * @details 縦横の窓の和を1行・1列ずつずらしながら更新するため、窓の大きさによらず1画素あたり定数回の演算で済む
+ *          (applyBoxFilter)。size = 3 のときはこれまでの3x3平均フィルタと同じ結果になる
  * @param src 元画像
- * @count dst 結果画像
+ * @param dst 結果画像
+ * @param size 窓の一辺 (奇数。偶数のときは1大きい奇数として扱う)
  */
-void applyAvarageFilter(BitmapManager *src, BitmapManager *dst){
-    //! 各画素の計算用(和、平均値)
-    int sum=0, ave=0;
-
-    // 上下左右1画素ずつ除いてループ
-    for (int row = 1; row < src->getHeight()-1; row++) {
-        for (int col = 1; col < src->getWidth()-1; col++) {
-
-            // 画素値取得、周囲の画素を取り込んで総和を取る
-            for (int innerRow = -1; innerRow <= 1; innerRow++) {
-                for (int innerCol = -1; innerCol <= 1; innerCol++) {
-                    sum += src->getColor(row+innerRow, col+innerCol).r;
-                }
-            }
+void applyAvarageFilter(GrayImage *src, GrayImage *dst, int size){
+    applyBoxFilter(*src, *dst, size / 2);
 
-            // 平均を出す (3x3 = 9)
-            ave = sum / 9;
-
-            // for debug
-            //cout << ave << endl;
-
-            // set
-            dst->setColor(row, col, ave, ave, ave);
-
-            // 変数リセット
-            sum = ave = 0;
-        }
-    }
     // for debug
     cout << "Completed: avarageFilter" << endl;
 }
 
 /**
- * @fn 3x3 ガウシアンフィルタを適用
+ * @fn ガウシアンフィルタを適用
+ * @details 1次元の重みを横・縦の2回に分けて掛ける (applySeparableGaussian)。
+ *          sigmaを指定しない (0以下) ときは3x3の2項係数 (1 2 1) を整数で厳密に用い、これまでの3x3ガウシアンフィルタと同じ結果になる
  * @param src 元画像
- * @count dst 結果画像
+ * @param dst 結果画像
+ * @param sigma 標準偏差
  */
-void applyGaussianFilter(BitmapManager *src, BitmapManager *dst){
-    //! 各画素の計算用(和、平均値)
-    int sum=0, ave=0;
-
-    //! 各画素にかけるフィルターの重み
-    int w[3][3] = {1, 2, 1,
-                   2, 4, 2,
-                   1, 2, 1};
-
-    for (int row = 1; row < src->getHeight()-1; row++) {
-        for (int col = 1; col < src->getWidth()-1; col++) {
-
-            // 画素値取得、周囲の画素を取り込む、wをかけることで重みもつける
-            for (int innerRow = -1; innerRow <= 1; innerRow++) {
-                for (int innerCol = -1; innerCol <= 1; innerCol++) {
-                    sum += src->getColor(row+innerRow, col+innerCol).r * w[innerRow+1][innerCol+1];
-                }
-            }
+void applyGaussianFilter(GrayImage *src, GrayImage *dst, double sigma){
+    applySeparableGaussian(*src, *dst, sigma > 0.0 ? makeGaussianKernel(sigma) : makeBinomialKernel(3));
 
-            // 平均を出す
-            ave = sum / 16;
-
-            // for debug
-            //cout << ave << endl;
-
-            // set
-            dst->setColor(row, col, ave, ave, ave);
-
-            // 変数リセット
-            sum = ave = 0;
-        }
-    }
     // for debug
     cout << "Completed: gaussianFilter" << endl;
 }
 
 /**
  * @fn メディアンフィルタ
+ * @details 3x3, 5x5では比較交換をSIMDで32画素ずつ行い、それより大きな窓では列ごとのヒストグラムを足し引きして
+ *          中央値を求める (applyMedian)。size = 3 のときはこれまでの3x3メディアンフィルタと同じ結果になる
  * @param src 元画像
- * @count dst 結果画像
+ * @param dst 結果画像
+ * @param size 窓の一辺 (奇数。偶数のときは1大きい奇数として扱う)
  */
-void applyMedianFilter(BitmapManager *src, BitmapManager *dst){
-    //! 
-    vector<int> elementArray;
-
-    //!
-    int tempMid = 0;
-
-    for (int row = 1; row < src->getHeight()-1; row++) {
-        for (int col = 1; col < src->getWidth()-1; col++) {
-
-            // 画素値取得、周囲の画素を取り込む
-            for (int innerRow = -1; innerRow <= 1; innerRow++) {
-                for (int innerCol = -1; innerCol <= 1; innerCol++) {
-                    elementArray.push_back(src->getColor(row+innerRow, col+innerCol).r);
-                }
-            }
+void applyMedianFilter(GrayImage *src, GrayImage *dst, int size){
+    applyMedian(*src, *dst, size / 2);
 
-            // ソートを行う
-            quick_sort(elementArray.begin(), elementArray.end());
-
-            // 中央値を取り出す
-            tempMid = elementArray[(elementArray.size() - 1) / 2];
-
-            // for debug
-            //cout << ave << endl;
-
-            // set
-            dst->setColor(row, col, tempMid, tempMid, tempMid);
-
-            // 変数リセット
-            elementArray.clear();
-            tempMid = 0;
-        }
-    }
     // for debug
     cout << "Completed: medianFilter" << endl;
 }
@@ -179,11 +64,23 @@ void applyMedianFilter(BitmapManager *src, BitmapManager *dst){
 
 int main(int argc, char *argv[]) {
 
-    if (argc != 2){
-        cerr << "Usage ./prog filename(without .bmp)" << endl;
+    // --probe: ヘッダーのみを読み込み、画像情報を一覧表示
+    if (argc >= 2 && string(argv[1]) == "--probe")
+        return probeFiles(argc - 2, argv + 2);
+
+    if (argc < 2 || argc > 5){
+        cerr << "Usage ./prog filename(without .bmp) [average filter size [gaussian sigma [median filter size]]]" << endl;
+        cerr << "      ./prog --probe file.bmp..." << endl;
         return -1;
     }
 
+    //! 平均フィルタの窓の一辺 (既定は3x3)
+    int averageSize = argc >= 3 ? atoi(argv[2]) : 3;
+    //! ガウシアンフィルタの標準偏差 (既定は3x3の2項係数)
+    double gaussianSigma = argc >= 4 ? atof(argv[3]) : 0.0;
+    //! メディアンフィルタの窓の一辺 (既定は3x3)
+    int medianSize = argc >= 5 ? atoi(argv[4]) : 3;
+
     //! ファイル名
     string src_filename = "src/" + string(argv[1]) + ".bmp";
     string gray_filename = "dst/" + string(argv[1]) + "_gray.bmp";
@@ -192,7 +89,8 @@ int main(int argc, char *argv[]) {
     string medianFilter_filename = "dst/" + string(argv[1]) + "_medianFilter.bmp";
 
     // Bitmap
-    BitmapManager src, dstAve, dstGauss, dstMedian;
+    BitmapManager src;
+    GrayImage gray, dstAve, dstGauss, dstMedian;
     // ヒストグラム用カウンタ
     int count[256] = {0};
 
@@ -201,24 +99,24 @@ int main(int argc, char *argv[]) {
     src.displayHeader();
 
     // グレースケール化
-    color2Grayscale(&src, count);
-    src.writeData(gray_filename);
+    color2Grayscale(&src, &gray, count);
+    gray.writeData(gray_filename);
 
     // 画像をコピー
-    dstAve.copy(src);
-    dstGauss.copy(src);
-    dstMedian.copy(src);
+    dstAve.copy(gray, true);
+    dstGauss.copy(gray, true);
+    dstMedian.copy(gray, true);
 
     // 平均フィルタ適用
-    applyAvarageFilter(&src, &dstAve);
+    applyAvarageFilter(&gray, &dstAve, averageSize);
     dstAve.writeData(avarageFilter_filename);
 
     // ガウシアンフィルタ適用
-    applyGaussianFilter(&src, &dstGauss);
+    applyGaussianFilter(&gray, &dstGauss, gaussianSigma);
     dstGauss.writeData(gaussianFilter_filename);
 
     // メディアンフィルタ適用
-    applyMedianFilter(&src, &dstMedian);
+    applyMedianFilter(&gray, &dstMedian, medianSize);
     dstMedian.writeData(medianFilter_filename);
 
     return 0;
@@ -0,0 +1,121 @@
+#include "async_writer.hpp"
+
+using namespace std;
+
+/**
+ * @fn コンストラクタ
+ * @param maxJobs キューに積める画像の数の上限
+ */
+AsyncWriter::AsyncWriter(size_t maxJobs) {
+    this->maxJobs = maxJobs > 0 ? maxJobs : 1;
+    writing = 0;
+    failed = 0;
+    stopping = false;
+
+    worker = thread(&AsyncWriter::run, this);
+}
+
+/**
+ * @fn デストラクタ
+ * @details キューに残っている画像をすべて書き出してからスレッドを終了する
+ */
+AsyncWriter::~AsyncWriter() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queued.notify_all();
+
+    worker.join();
+}
+
+/**
+ * @fn 書き出しを予約する
+ * @param filename ファイルの名前
+ * @param img 書き出す画像 (以降に書き込んでも、書き出す内容は呼び出し時点のもの)
+ * @param format 書き出し形式 (既定は24bit形式)
+ */
+void AsyncWriter::write(string filename, BitmapManager &img, WriteFormat format) {
+    WriteJob job;
+    job.filename = filename;
+    img.encode(job.bmp, format);
+
+    enqueue(job);
+}
+
+/**
+ * @fn 書き出しを予約する
+ * @param filename ファイルの名前
+ * @param img 書き出す画像 (以降に書き込んでも、書き出す内容は呼び出し時点のもの)
+ * @param format 書き出し形式 (既定は8bitパレット形式)
+ */
+void AsyncWriter::write(string filename, GrayImage &img, WriteFormat format) {
+    WriteJob job;
+    job.filename = filename;
+    img.encode(job.bmp, format);
+
+    enqueue(job);
+}
+
+/**
+ * @fn キューに積む
+ * @details キューが上限に達している場合は空きができるまで待つ
+ * @param job 書き出す画像 (中身はキューへ移される)
+ */
+void AsyncWriter::enqueue(WriteJob &job) {
+    {
+        unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return jobs.size() < maxJobs; });
+
+        jobs.push_back(std::move(job));
+    }
+    queued.notify_one();
+}
+
+/**
+ * @fn キューが空になり、書き出しが終わるまで待つ
+ */
+void AsyncWriter::flush() {
+    unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return jobs.empty() && writing == 0; });
+}
+
+/**
+ * @fn 書き出しに失敗した数を取得
+ * @return 失敗した数
+ */
+int AsyncWriter::getFailedCount() {
+    lock_guard<std::mutex> lock(mutex);
+    return failed;
+}
+
+/**
+ * @fn 書き出し用スレッドの処理
+ * @details キューから1つずつ取り出して書き出す。終了要求があってもキューが空になるまでは続ける
+ */
+void AsyncWriter::run() {
+    unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        queued.wait(lock, [this] { return !jobs.empty() || stopping; });
+
+        if (jobs.empty())
+            break;
+
+        WriteJob job = std::move(jobs.front());
+        jobs.pop_front();
+        writing = 1;
+
+        // 書き出しはロックの外で行う
+        lock.unlock();
+        bool ok = writeEncodedBitmap(job.filename, job.bmp);
+        // 共有していた画素データはここで手放す
+        job.bmp.buffer.reset();
+        lock.lock();
+
+        if (!ok)
+            failed++;
+        writing = 0;
+        done.notify_all();
+    }
+}
@@ -5,6 +5,8 @@
 #include <cstring>
 #include <cmath>
 #include <vector>
+#include <memory>
+#include "buffer_pool.hpp"
 
 //! @def BMPのファイルヘッダー、情報ヘッダーのサイズ
 #define FILE_HEADER_SIZE 14
@@ -17,6 +19,7 @@ typedef struct FileHeader {
     uint8_t origData[FILE_HEADER_SIZE];
     std::string type;  // タイプ
     int size;  // サイズ
+    int offset;  // 画素データまでのオフセット
 } FileHeader;
 
 /**
@@ -28,6 +31,8 @@ typedef struct InfoHeader {
     int width;  // 幅
     int height;  // 高さ
     int colorParPixel;  // 1ピクセルあたりの色数
+    int compression;  // 圧縮形式 (0: 無圧縮, 3: ビットフィールド)
+    int colorsUsed;  // パレットの色数 (0のときは 2^colorParPixel)
     int dataSize;  // サイズ
 } InfoHeader;
 
@@ -40,6 +45,15 @@ typedef struct Color {
     int b;
 } Color;
 
+/**
+ * @brief 24bit画像の1画素 (メモリ上の並び順)
+ */
+typedef struct BgrPixel {
+    uint8_t b;
+    uint8_t g;
+    uint8_t r;
+} BgrPixel;
+
 /**
  * @brief 画素の位置を定義
  */
@@ -49,7 +63,103 @@ typedef struct ColorPosition {
     int b;
 } ColorPosition;
 
+/**
+ * @brief ヘッダーのみを読み込んだ結果 (画素データは読まない)
+ */
+typedef struct BitmapProbe {
+    int fileSize;  // ファイルサイズ (ヘッダー上)
+    int width;  // 幅
+    int height;  // 高さ (トップダウンでも正の値)
+    int bitParPixel;  // 1ピクセルあたりのビット数
+    int dataSize;  // 画素データのサイズ
+    bool topdown;  // トップダウン形式かどうか
+} BitmapProbe;
+
+/**
+ * @brief 画素データの読み込み方法
+ */
+enum LoadMode {
+    LOAD_COPY,  // freadでヒープ領域へ読み込む
+    LOAD_MMAP   // ファイルをプライベートマッピングし、画素データを直接参照する (書き込み時はコピーオンライト)
+};
+
+/**
+ * @brief 画素データの書き出し形式
+ */
+enum WriteFormat {
+    WRITE_DEFAULT,  // 無圧縮 (BitmapManagerは24bit、GrayImageは8bitパレット)
+    WRITE_1BIT,     // 1bit白黒 (画素値128以上を白とする。2値画像用)
+    WRITE_RLE8      // 8bitパレットのランレングス圧縮 (BI_RLE8)
+};
+
 int bit2Integer(uint8_t, uint8_t, uint8_t, uint8_t);
+void integer2Bit(int, uint8_t *);
+int rowStride(int width, int bitParPixel);
+void parseFileHeader(const uint8_t *, FileHeader &);
+void parseInfoHeader(const uint8_t *, const FileHeader &, InfoHeader &);
+void buildHeaders(int width, int height, int bitParPixel, FileHeader &, InfoHeader &);
+void appendGrayPalette(std::vector<uint8_t> &, int bitParPixel);
+void writeGrayPalette(FILE *, int bitParPixel);
+bool probeBitmap(std::string filename, BitmapProbe &);
+int probeFiles(int count, char *files[]);
+
+/**
+ * @brief 画素データの領域
+ * @details BitmapManager, GrayImageが共有ポインタで保持する。copyでコピーオンライトを指定した場合は
+ *          複数の画像から共有され、書き込む側が書き込みの直前に複製を作る。
+ *          画素データの領域はBufferPoolから払い出し、解放時にBufferPoolへ返却する
+ *          (PixelBuffer自体とshared_ptrの制御ブロックは通常のヒープから確保する)
+ */
+class PixelBuffer {
+    // フィールド定義
+    uint8_t *data;
+    size_t size;
+    PoolBlock block;  // BufferPoolから払い出された領域
+
+    // LOAD_MMAPで読み込んだときのマッピング先頭とサイズ
+    uint8_t *mappedData;
+    size_t mappedSize;
+
+public:
+    // コンストラクタ
+    explicit PixelBuffer(size_t size);  // BufferPoolから確保
+    PixelBuffer(uint8_t *mappedData, size_t mappedSize, size_t offset, size_t size);  // マッピングの一部を画素データとする
+
+    // デストラクタ
+    ~PixelBuffer();
+
+    // 共有ポインタ経由でのみ扱うため、コピーは禁止
+    PixelBuffer(const PixelBuffer &) = delete;
+    PixelBuffer &operator=(const PixelBuffer &) = delete;
+
+    uint8_t *getData() {
+        return data;
+    }
+    size_t getSize() {
+        return size;
+    }
+    bool isMapped() {
+        return mappedData != nullptr;
+    }
+};
+
+typedef std::shared_ptr<PixelBuffer> PixelBufferPtr;
+
+/**
+ * @brief 書き出し用にまとめたビットマップ
+ * @details ヘッダー (パレットを含む) はコピーして持ち、画素データは共有ポインタで参照する。
+ *          元の画像がこの後に書き込まれても、コピーオンライトにより書き出す内容は変わらない
+ */
+typedef struct EncodedBitmap {
+    std::vector<uint8_t> header;  // ファイルヘッダー、情報ヘッダー、パレット
+    PixelBufferPtr buffer;  // 画素データの領域 (書き出し終わるまで保持する)
+    const uint8_t *data;  // 画素データの先頭
+    size_t size;  // 画素データのサイズ
+} EncodedBitmap;
+
+bool writeEncodedBitmap(std::string filename, const EncodedBitmap &);
+void encodeGrayPixels(const uint8_t *pixels, int srcStride, int step, int width, int height,
+                      WriteFormat format, EncodedBitmap &);
 
 /**
  * @brief ビットマップ処理クラス
@@ -58,11 +168,15 @@ int bit2Integer(uint8_t, uint8_t, uint8_t, uint8_t);
 class BitmapManager {
     // フィールド定義
     FILE *file; 
-    uint8_t *image;
+    uint8_t *image;  // buffer->getData()を保持したもの
+    PixelBufferPtr buffer;
     FileHeader fileHeader;
     InfoHeader infoHeader;
 
-    // 画像形式がトップダウンかどうか
+    // 1行あたりのバイト数 (4バイト境界に揃えたもの)。ヘッダー読み込み時に一度だけ計算する
+    int stride;
+
+    // 読み込んだファイルがトップダウンだったかどうか (画素データは常にボトムアップで保持する)
     bool is_topdown = false;
 
 public:
@@ -70,17 +184,25 @@ public:
     BitmapManager() {
         file = nullptr;
         image = nullptr;
+        stride = 0;
     }
 
     // デストラクタ
     ~BitmapManager() {
-        fclose(file);
-        delete[] image;
+        if (file != nullptr)
+            fclose(file);
     }
 
+    // ムーブ (画素データの所有権を移す)。コピーはcopy()で明示的に行う
+    BitmapManager(BitmapManager &&src);
+    BitmapManager &operator=(BitmapManager &&src);
+    BitmapManager(const BitmapManager &) = delete;
+    BitmapManager &operator=(const BitmapManager &) = delete;
+
     // メソッド定義
-    void loadData(std::string filename);  // データ読み込み
-    void writeData(std::string filename);  // データ書き込み
+    void loadData(std::string filename, LoadMode mode = LOAD_COPY);  // データ読み込み
+    void writeData(std::string filename, WriteFormat format = WRITE_DEFAULT);  // データ書き込み
+    void encode(EncodedBitmap &, WriteFormat format = WRITE_DEFAULT);  // 書き出し用にヘッダーと画素データをまとめる
     void displayHeader();  // 画像情報を標準出力へ出力
     int getHeight();  // 画像の高さの大きさを取得
     int getWidth();  // 画像の幅の大きさを取得
@@ -92,12 +214,57 @@ public:
     void setFileHeader(FileHeader);
     InfoHeader getInfoHeader();
     void setInfoHeader(InfoHeader);
-    void copy(BitmapManager &);
+    void copy(BitmapManager &, bool copyOnWrite = false);  // copyOnWrite: 書き込まれるまで画素データを共有
+    void create(int width, int height);  // 指定サイズの24bit画像を生成
+
+    // 行単位のアクセス (範囲確認は行わないため、0 <= row < height で呼ぶこと)
+    // getRow, getBgrRowは共有中の画素データを取得時に複製する。得たポインタは、その後にcopy(…, true)や
+    // encode() (AsyncWriter::write()を含む) で画素データを共有すると無効になる (書き込むと共有先の画像も変わる)。
+    // 共有した後に書き込むときは取得し直すこと。読み込みのみの場合はgetConst〜を用いる (共有中の画素データを複製しない)
+    int getStride();  // 1行あたりのバイト数を取得
+    uint8_t *getRow(int row);  // 指定した行の先頭を取得
+    BgrPixel *getBgrRow(int row);  // 指定した行をBGR画素の配列として取得
+    const uint8_t *getConstRow(int row);
+    const BgrPixel *getConstBgrRow(int row);
+
+    // 画素データを他の画像と共有しているとき、書き込み前に複製する。
+    // 共有の判定はbuffer.use_count()のみで行う。AsyncWriterは別スレッドで参照を保持・解放するため、この値はその時点の
+    // 目安に過ぎない (解放の直後でも共有中に見え、余分に複製することがある)。それでも安全なのは、copy(…, true)の相手は
+    // 書き込む前に自身で複製し、書き出しのために保持する側 (encode()の結果、AsyncWriter) は読むだけで書き込まないため。
+    // 書き込む共有者を追加するときは、use_count()ではなく共有を明示的に管理すること
+    void prepareWrite() {
+        if (buffer.use_count() > 1)
+            detach();
+    }
+
+    // 範囲確認を行わない画素アクセス (畳み込みなどのループ内で用いる)
+    // setColorUncheckedは共有中の画素データを複製しないため、ループの前にprepareWrite()を呼んでおくこと
+    Color getColorUnchecked(int row, int col) {
+        const uint8_t *p = image + row * stride + 3 * col;
+        return {p[2], p[1], p[0]};
+    }
+    void setColorUnchecked(int row, int col, int r, int g, int b) {
+        uint8_t *p = image + row * stride + 3 * col;
+        p[0] = b;
+        p[1] = g;
+        p[2] = r;
+    }
+
+    // 帯単位の読み書きで画素データを直接扱う
+    friend class BitmapBandReader;
+    friend class BitmapBandWriter;
 
 private:
     void readFileHeader();
     void readInfoHeader();
     void readImageData();
+    void mapImageData();
+    bool isInternalLayout();
+    size_t sourceDataSize();
+    void unpackImage(const uint8_t *pixels, const uint8_t *extra, size_t extraSize);
+    void releaseImage();
+    void resetImage();
+    void detach();
 };
 
 #endif // BITMAP_MANAGER_HPP
\ No newline at end of file
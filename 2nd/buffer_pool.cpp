@@ -0,0 +1,230 @@
+#include "buffer_pool.hpp"
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+
+using namespace std;
+
+//! @def huge pageを用いる最小サイズ (2MB)
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+//! @def 保持する未使用領域の上限 (初期値)
+#define DEFAULT_MAX_CACHED_BYTES ((size_t)512 * 1024 * 1024)
+
+/**
+ * @fn コンストラクタ
+ */
+BufferPool::BufferPool() {
+    stats = {0, 0, 0, 0, 0, 0, 0};
+    maxCachedBytes = DEFAULT_MAX_CACHED_BYTES;
+    useHugePages = false;
+}
+
+/**
+ * @fn デストラクタ
+ */
+BufferPool::~BufferPool() {
+    clear();
+}
+
+/**
+ * @fn プロセス全体で共有するプールを取得
+ * @return プール
+ */
+BufferPool &BufferPool::instance() {
+    static BufferPool pool;
+    return pool;
+}
+
+/**
+ * @fn 要求サイズをサイズ区分に切り上げる
+ * @details 4KB未満は4KBに、それ以上は 2^k, 1.25*2^k, 1.5*2^k, 1.75*2^k のいずれかに切り上げる
+ * @param size 要求サイズ
+ * @return サイズ区分
+ */
+size_t BufferPool::bucketSize(size_t size) {
+    if (size <= 4096)
+        return 4096;
+
+    //! size以下で最大の2のべき乗
+    size_t base = 4096;
+    while (base * 2 <= size)
+        base *= 2;
+
+    //! 区分の刻み幅
+    size_t step = base / 4;
+
+    return (size + step - 1) / step * step;
+}
+
+/**
+ * @fn 新しい領域を確保する
+ * @param capacity サイズ区分
+ * @param hugePages 2MB以上の領域をhuge pageで確保するかどうか (ロック中に読んだuseHugePages)
+ * @return 確保した領域 (失敗時はdataがnullptr)
+ */
+PoolBlock BufferPool::allocate(size_t capacity, bool hugePages) {
+    PoolBlock block = {nullptr, capacity, false};
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (hugePages && capacity >= HUGE_PAGE_SIZE) {
+        void *addr = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr != MAP_FAILED) {
+            // 透過的huge pageを要求 (使えない環境では通常のページになる)
+            madvise(addr, capacity, MADV_HUGEPAGE);
+            block.data = (uint8_t *)addr;
+            block.mapped = true;
+            return block;
+        }
+    }
+#endif
+
+    // SIMD処理で扱いやすいよう64バイト境界に揃える
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, 64, capacity) == 0)
+        block.data = (uint8_t *)ptr;
+
+    return block;
+}
+
+/**
+ * @fn 領域を解放する
+ * @param block 解放する領域
+ */
+void BufferPool::deallocate(PoolBlock block) {
+    if (block.mapped)
+        munmap(block.data, block.capacity);
+    else
+        free(block.data);
+}
+
+/**
+ * @fn size以上の領域を払い出す
+ * @details 同じサイズ区分の未使用領域があれば再利用し、なければ新たに確保する。
+ *          新たに確保した領域は、確保に成功してから払い出し中のバイト数へ加える
+ * @param size 要求サイズ
+ * @return 払い出した領域
+ */
+PoolBlock BufferPool::acquire(size_t size) {
+    //! サイズ区分
+    size_t capacity = bucketSize(size);
+    //! huge pageで確保するかどうか (setHugePagesと競合しないようロック中に読む)
+    bool hugePages;
+
+    {
+        lock_guard<std::mutex> lock(mutex);
+
+        auto itr = freeBlocks.find(capacity);
+        if (itr != freeBlocks.end() && !itr->second.empty()) {
+            PoolBlock block = itr->second.back();
+            itr->second.pop_back();
+
+            stats.hits++;
+            stats.bytesCached -= capacity;
+            stats.bytesInUse += capacity;
+            if (stats.peakBytesInUse < stats.bytesInUse)
+                stats.peakBytesInUse = stats.bytesInUse;
+            return block;
+        }
+
+        hugePages = useHugePages;
+    }
+
+    // 確保はロックの外で行う
+    PoolBlock block = allocate(capacity, hugePages);
+
+    if (block.data == nullptr) {
+        cerr << "Error: BufferPool: " << capacity << "バイトの確保に失敗" << endl;
+        throw bad_alloc();
+    }
+
+    lock_guard<std::mutex> lock(mutex);
+
+    stats.misses++;
+    stats.bytesInUse += capacity;
+    if (stats.peakBytesInUse < stats.bytesInUse)
+        stats.peakBytesInUse = stats.bytesInUse;
+
+    return block;
+}
+
+/**
+ * @fn 領域を返却する
+ * @details 保持している未使用領域が上限を超える場合は解放する
+ * @param block 返却する領域 (acquireで払い出したもの)
+ */
+void BufferPool::release(PoolBlock block) {
+    if (block.data == nullptr)
+        return;
+
+    {
+        lock_guard<std::mutex> lock(mutex);
+
+        stats.releases++;
+        stats.bytesInUse -= block.capacity;
+
+        if (stats.bytesCached + block.capacity <= maxCachedBytes) {
+            freeBlocks[block.capacity].push_back(block);
+            stats.bytesCached += block.capacity;
+            return;
+        }
+
+        stats.discards++;
+    }
+
+    deallocate(block);
+}
+
+/**
+ * @fn 保持している未使用領域をすべて解放する
+ */
+void BufferPool::clear() {
+    lock_guard<std::mutex> lock(mutex);
+
+    for (auto itr = freeBlocks.begin(); itr != freeBlocks.end(); ++itr) {
+        for (auto block = itr->second.begin(); block != itr->second.end(); ++block)
+            deallocate(*block);
+    }
+
+    freeBlocks.clear();
+    stats.bytesCached = 0;
+}
+
+/**
+ * @fn 保持する未使用領域の上限を設定
+ * @param bytes 上限 (バイト)
+ */
+void BufferPool::setMaxCachedBytes(size_t bytes) {
+    lock_guard<std::mutex> lock(mutex);
+    maxCachedBytes = bytes;
+}
+
+/**
+ * @fn 2MB以上の領域をhuge pageで確保するかどうかを設定
+ * @details 以降に新たに確保する領域にのみ反映される
+ * @param enable 有効にするかどうか
+ */
+void BufferPool::setHugePages(bool enable) {
+    lock_guard<std::mutex> lock(mutex);
+    useHugePages = enable;
+}
+
+/**
+ * @fn 統計情報を取得
+ * @return 統計情報
+ */
+PoolStats BufferPool::getStats() {
+    lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+/**
+ * @fn 統計情報を標準出力に表示
+ */
+void BufferPool::displayStats() {
+    PoolStats s = getStats();
+
+    cout << "BufferPool hits:    " << s.hits << endl;
+    cout << "BufferPool misses:  " << s.misses << endl;
+    cout << "BufferPool cached:  " << s.bytesCached << " bytes" << endl;
+    cout << "BufferPool peak:    " << s.peakBytesInUse << " bytes" << endl;
+}
@@ -0,0 +1,74 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <iostream>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief プールから払い出した領域
+ */
+typedef struct PoolBlock {
+    uint8_t *data;
+    size_t capacity;  // 実際に確保したサイズ (サイズ区分に切り上げたもの)
+    bool mapped;  // mmapで確保したかどうか (huge page用)
+} PoolBlock;
+
+/**
+ * @brief プールの統計情報
+ */
+typedef struct PoolStats {
+    long hits;  // 再利用できた回数
+    long misses;  // 新たに確保した回数
+    long releases;  // 返却された回数
+    long discards;  // 上限を超えたため解放した回数
+    size_t bytesInUse;  // 払い出し中のバイト数
+    size_t bytesCached;  // 再利用のために保持しているバイト数
+    size_t peakBytesInUse;  // 払い出し中のバイト数の最大値
+} PoolStats;
+
+/**
+ * @brief 画素データ用の領域をサイズ区分ごとに再利用するプール
+ * @details 各処理の中間画像は毎フレーム同じサイズで確保・解放されるため、解放された領域を保持しておき、
+ *          次の確保で払い出す。同じサイズの処理を繰り返す限り、画素データの確保はmalloc/mmapを経由しない。
+ *          対象は画素データの領域のみで、PixelBufferとshared_ptrの制御ブロック (make_shared)、
+ *          parallelForのスレッドや作業用のvectorは、これまでどおり呼び出しのたびにヒープから確保される。
+ *          サイズ区分は2のべき乗を4分割したもので、切り上げによる無駄は最大25%
+ */
+class BufferPool {
+    // フィールド定義
+    std::mutex mutex;
+    std::map<size_t, std::vector<PoolBlock>> freeBlocks;  // サイズ区分ごとの未使用領域
+    PoolStats stats;
+    size_t maxCachedBytes;  // 保持する未使用領域の上限
+    bool useHugePages;  // 大きな領域をhuge pageで確保するかどうか
+
+    // コンストラクタ (instance()からのみ生成)
+    BufferPool();
+
+public:
+    // デストラクタ
+    ~BufferPool();
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    // メソッド定義
+    static BufferPool &instance();  // プロセス全体で共有するプール
+    PoolBlock acquire(size_t size);  // size以上の領域を払い出す
+    void release(PoolBlock block);  // 領域を返却する
+    void clear();  // 保持している未使用領域をすべて解放
+    void setMaxCachedBytes(size_t bytes);
+    void setHugePages(bool enable);  // 2MB以上の領域をhuge pageで確保する (Linuxのみ有効)
+    PoolStats getStats();
+    void displayStats();  // 統計情報を標準出力へ出力
+
+private:
+    static size_t bucketSize(size_t size);
+    static PoolBlock allocate(size_t capacity, bool hugePages);
+    static void deallocate(PoolBlock block);
+};
+
+#endif // BUFFER_POOL_HPP
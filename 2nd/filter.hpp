@@ -0,0 +1,57 @@
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+#include <vector>
+#include "gray_image.hpp"
+
+/**
+ * @brief 平滑化フィルタ
+ * @details いずれも src を読み、dst へ書き込む (dst は src と同じ大きさで作り直される。src と同じ画像は指定できない)。
+ *          端から半径以内の画素は、これまでの3x3のフィルタと同じく元の値のままとする
+ */
+
+void applyBoxFilter(GrayImage &src, GrayImage &dst, int radius);  // 一辺 2 * radius + 1 の平均フィルタ (半径によらずO(1)/画素)
+
+//! @def ガウシアンフィルタの1次元の重みの合計 (2^GAUSSIAN_BITS。2次元の重みの合計は2^(2 * GAUSSIAN_BITS))
+#define GAUSSIAN_BITS 12
+//! @def 2項係数の重みで作れる最大の一辺 (2次元の重みの合計が2^24以下となる大きさ)
+#define BINOMIAL_MAX_SIZE 13
+
+/**
+ * @brief 分離可能なガウシアンフィルタの1次元の重み
+ * @details 横・縦の2回に分けて同じ重みを掛ける。重みは整数で、2次元の重みの合計は 2^shift となる。
+ *          結果は 重み付きの和 / 2^shift を、rounding なら四捨五入、そうでなければ切り捨てとする
+ */
+struct GaussianKernel {
+    std::vector<int> weights;  // 2 * radius + 1個
+    int radius;
+    int shift;
+    bool rounding;
+};
+
+GaussianKernel makeGaussianKernel(double sigma, int radius = 0);  // 標準偏差sigma (radius 0 のときは ceil(3 * sigma))
+GaussianKernel makeBinomialKernel(int size);  // 一辺sizeの2項係数 (3x3: 1 2 1, 5x5: 1 4 6 4 1。これまでのフィルタと同じ結果)
+void applySeparableGaussian(GrayImage &src, GrayImage &dst, const GaussianKernel &kernel);  // 横・縦の2回に分けて適用
+void applyRecursiveGaussian(GrayImage &src, GrayImage &dst, double sigma);  // 再帰型 (IIR) の近似。sigmaによらずO(1)/画素、端まで処理する (sigma 5以上でFIRより速い)
+
+//! @def 中央値フィルタの最大の半径 (窓の画素数を16bitの度数で数えられる大きさ)
+#define MEDIAN_MAX_RADIUS 127
+//! @def 中央値フィルタで並列に処理するタイルの一辺
+#define MEDIAN_TILE_SIZE 256
+
+void applyHistogramMedian(GrayImage &src, GrayImage &dst, int radius);  // 一辺 2 * radius + 1 の中央値フィルタ (半径によらずO(1)/画素)
+void applyNetworkMedian(GrayImage &src, GrayImage &dst, int radius);  // 3x3 (radius 1), 5x5 (radius 2) の比較交換による中央値フィルタ
+void applyMedian(GrayImage &src, GrayImage &dst, int radius);  // 半径に応じて上の2つから選ぶ
+
+/**
+ * @brief 2つの画像の差 (フィルタの近似の精度の確認用)
+ */
+struct ImageDifference {
+    int maxError;  // 差の絶対値の最大値
+    double meanError;  // 差の絶対値の平均
+    long long pixels;  // 比べた画素数
+};
+
+ImageDifference compareImages(GrayImage &a, GrayImage &b, int margin);  // 端からmargin画素を除いて比べる
+
+#endif // FILTER_HPP
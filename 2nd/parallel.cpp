@@ -0,0 +1,25 @@
+#include "parallel.hpp"
+
+//! 並列処理に用いるスレッド数 (0のときはCPUのコア数)
+static int threadCount = 0;
+
+/**
+ * @fn 並列処理に用いるスレッド数を取得
+ * @return スレッド数 (1以上)
+ */
+int getThreadCount() {
+    if (threadCount > 0)
+        return threadCount;
+
+    //! CPUのコア数 (取得できない場合は0)
+    int cores = std::thread::hardware_concurrency();
+    return cores > 0 ? cores : 1;
+}
+
+/**
+ * @fn 並列処理に用いるスレッド数を設定
+ * @param count スレッド数 (0以下のときはCPUのコア数)
+ */
+void setThreadCount(int count) {
+    threadCount = count > 0 ? count : 0;
+}
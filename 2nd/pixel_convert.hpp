@@ -0,0 +1,51 @@
+#ifndef PIXEL_CONVERT_HPP
+#define PIXEL_CONVERT_HPP
+
+#include <cstdint>
+
+/**
+ * @brief 1行単位の画素形式の変換
+ * @details x86ではSSSE3 (pshufb) によるバイト並べ替えで複数画素をまとめて変換する。
+ *          SSSE3を使えないCPU、x86以外の環境では同じ結果になる1画素ずつの処理を用いる
+ */
+
+void convertBgraToBgr(const uint8_t *src, uint8_t *dst, int width);  // 32bit (B, G, R, A) -> 24bit
+void convertGrayToBgr(const uint8_t *src, uint8_t *dst, int width);  // 8bit (値をそのまま) -> 24bit
+void convertIndexedToBgr(const uint8_t *src, const uint8_t *palette, uint8_t *dst, int width);  // 8bitパレット -> 24bit
+bool isGrayPalette(const uint8_t *palette, int colors);  // パレットがi番目 = (i, i, i) かどうか
+
+/**
+ * @brief グレイスケール化の係数 (0.3, 0.59, 0.11 を 2^15 倍した固定小数点数)
+ * @details gray = (GRAY_WEIGHT_R * r + GRAY_WEIGHT_G * g + GRAY_WEIGHT_B * b + GRAY_ROUND) >> 15。
+ *          全1677万色で (30r + 59g + 11b) / 100 の切り捨てと一致し、
+ *          float演算 (int)(0.3f * r + 0.59f * g + 0.11f * b) との差は最大1 (floatの丸め誤差で整数値をわずかに下回る約0.17%の色で+1)
+ */
+#define GRAY_WEIGHT_R 9830
+#define GRAY_WEIGHT_G 19333
+#define GRAY_WEIGHT_B 3605
+#define GRAY_ROUND 160
+
+void convertBgrToGray(const uint8_t *src, uint8_t *dst, int width);  // 24bit (B, G, R) -> 8bitグレイスケール
+void convertByTable(const uint8_t *src, uint8_t *dst, const uint8_t *table, int width);  // 8bit -> 変換表 [0 256) で置き換えた8bit
+
+/**
+ * @brief YCbCr (JPEGと同じBT.601のフルレンジ) の係数 (2^14 倍した固定小数点数)
+ * @details Y = 0.299R + 0.587G + 0.114B, Cb = 128 - 0.168736R - 0.331264G + 0.5B,
+ *          Cr = 128 + 0.5R - 0.418688G - 0.081312B を四捨五入し、0〜255に収める
+ */
+#define YCBCR_Y_R 4899
+#define YCBCR_Y_G 9617
+#define YCBCR_Y_B 1868
+#define YCBCR_CB_R (-2765)
+#define YCBCR_CB_G (-5427)
+#define YCBCR_CB_B 8192
+#define YCBCR_CR_R 8192
+#define YCBCR_CR_G (-6860)
+#define YCBCR_CR_B (-1332)
+#define YCBCR_ROUND (1 << 13)
+#define YCBCR_OFFSET ((128 << 14) + YCBCR_ROUND)
+
+void convertBgrToHsv(const uint8_t *src, uint8_t *dst, int width);  // 24bit (B, G, R) -> 24bit (H 0〜179, S, V)
+void convertBgrToYcbcr(const uint8_t *src, uint8_t *dst, int width);  // 24bit (B, G, R) -> 24bit (Y, Cb, Cr)
+
+#endif // PIXEL_CONVERT_HPP
@@ -1,4 +1,6 @@
 #include "bitmap_manager.hpp"
+#include "gray_image.hpp"
+#include "bitmap_stream.hpp"
 
 using namespace std;
 
@@ -7,35 +9,13 @@ using namespace std;
 
 /**
  * @fn カラー画像をグレイスケール画像へ変換
+ * @details 0.3R + 0.59G + 0.11B を固定小数点で求める。変換とヒストグラムの集計は行を分けて並列に行う
  * @param bmp ビットマップマネージャー
+ * @param gray 出力先のグレイスケール画像
  * @count ヒストグラム用の配列 [0 256)
  */
-void color2Grayscale(BitmapManager *bmp, int *count) {
-    //! 各色に乗ずる係数
-    const float c_r = 0.3;
-    const float c_g = 0.59;
-    const float c_b = 0.11;
-
-    //! 各画素の色を保存する変数
-    Color color;
-    //! カラー画素から生成したグレイスケールの値
-    int grayValue;
-
-    for (int row = 0; row < bmp->getHeight(); row++){
-        for (int col = 0; col < bmp->getWidth(); col++){
-            // カラー取得
-            color = bmp->getColor(row, col);
-
-            // 変換式によってグレースケールへ変換
-            grayValue = (int)(c_r * color.r + c_g * color.g + c_b * color.b);
-
-            // 求めたグレースケール値をセット
-            bmp->setColor(row, col, grayValue, grayValue, grayValue);
-
-            // ヒストグラム用にグレースケール値をカウント
-            count[grayValue]++;
-        }
-    }
+void color2Grayscale(BitmapManager *bmp, GrayImage *gray, int *count) {
+    gray->fromColor(*bmp, count);
 }
 
 /**
@@ -44,7 +24,7 @@ void color2Grayscale(BitmapManager *bmp, int *count) {
  * @param dst 結果画像
  * @param mode (prewitt or sobel)
  */
-void applyEdgeFilter(BitmapManager *src, BitmapManager *dst, int mode){
+void applyEdgeFilter(GrayImage *src, GrayImage *dst, int mode){
     // エラー処理 (モードが適切かどうかを判定)
     if ((mode != PREWITT) && (mode != SOBEL)) {
         cerr << "applyEgdeFilter: mode error" << endl;
@@ -79,12 +59,12 @@ void applyEdgeFilter(BitmapManager *src, BitmapManager *dst, int mode){
             for (int innerRow = -1; innerRow <= 1; innerRow++) {
                 for (int innerCol = -1; innerCol <= 1; innerCol++) {
                     if (mode == PREWITT) {
-                        gx += src->getColor(row+innerRow, col+innerCol).r * prewitt_wx[innerRow+1][innerCol+1];
-                        gy += src->getColor(row+innerRow, col+innerCol).r * prewitt_wy[innerRow+1][innerCol+1];
+                        gx += src->getValue(row+innerRow, col+innerCol) * prewitt_wx[innerRow+1][innerCol+1];
+                        gy += src->getValue(row+innerRow, col+innerCol) * prewitt_wy[innerRow+1][innerCol+1];
                     }
                     if (mode == SOBEL) {
-                        gx += src->getColor(row+innerRow, col+innerCol).r * sobel_wx[innerRow+1][innerCol+1];
-                        gy += src->getColor(row+innerRow, col+innerCol).r * sobel_wy[innerRow+1][innerCol+1];
+                        gx += src->getValue(row+innerRow, col+innerCol) * sobel_wx[innerRow+1][innerCol+1];
+                        gy += src->getValue(row+innerRow, col+innerCol) * sobel_wy[innerRow+1][innerCol+1];
 
                     }
                 }
@@ -100,7 +80,7 @@ void applyEdgeFilter(BitmapManager *src, BitmapManager *dst, int mode){
             //cout << ave << endl;
 
             // set
-            dst->setColor(row, col, g, g, g);
+            dst->setValue(row, col, g);
 
             // 変数リセット
             gx = gy = g = 0;
@@ -121,7 +101,7 @@ void applyEdgeFilter(BitmapManager *src, BitmapManager *dst, int mode){
  * @param src 元画像
  * @param dst 結果画像
  */
-void applyLaplacianFilter(BitmapManager *src, BitmapManager *dst){
+void applyLaplacianFilter(GrayImage *src, GrayImage *dst){
     //! 各画素の計算用(和、平均値)
     int tempElement = 0;
 
@@ -136,7 +116,7 @@ void applyLaplacianFilter(BitmapManager *src, BitmapManager *dst){
             // 画素値取得、周囲の画素を取り込む、wx, wyをかけることで重みもつける
             for (int innerRow = -1; innerRow <= 1; innerRow++) {
                 for (int innerCol = -1; innerCol <= 1; innerCol++) {
-                    tempElement += src->getColor(row+innerRow, col+innerCol).r * w[innerRow+1][innerCol+1];
+                    tempElement += src->getValue(row+innerRow, col+innerCol) * w[innerRow+1][innerCol+1];
                 }
             }
 
@@ -148,7 +128,7 @@ void applyLaplacianFilter(BitmapManager *src, BitmapManager *dst){
             //cout << ave << endl;
 
             // set
-            dst->setColor(row, col, tempElement, tempElement, tempElement);
+            dst->setValue(row, col, tempElement);
 
             // 変数リセット
             tempElement = 0;
@@ -160,10 +140,64 @@ void applyLaplacianFilter(BitmapManager *src, BitmapManager *dst){
     return;
 }
 
+/**
+ * @fn 画像全体を読み込まずに、帯単位で各フィルタを適用する
+ * @details 3x3フィルタのため、上下1行の余白を付けて読み込む。出力は画像全体に適用した場合と同じになる
+ * @param src_filename 元画像
+ * @param dst_filenames 出力画像 (gray, prewitt, sobel, laplacianの順)
+ * @param bandRows 1つの帯の行数
+ */
+void applyFiltersByBand(string src_filename, string *dst_filenames, int bandRows) {
+    BitmapBandReader reader;
+    BitmapBandWriter writer[4];
+
+    if (!reader.open(src_filename, bandRows, 1))
+        return;
+
+    for (int i = 0; i < 4; i++) {
+        if (!writer[i].open(dst_filenames[i], reader.getWidth(), reader.getHeight(), 8))
+            return;
+    }
+
+    //! 帯画像 (使い回す)
+    BitmapManager band;
+    GrayImage grayBand, dstPrewitt, dstSobel, dstLaplacian;
+    //! 帯の範囲
+    BandRange range;
+    //! for color2Grayscale (余白の行も数えるため、帯ごとに捨てる)
+    int count[256];
+
+    while (reader.readBand(band, range)) {
+        memset(count, 0, sizeof count);
+        color2Grayscale(&band, &grayBand, count);
+
+        dstPrewitt.copy(grayBand, true);
+        dstSobel.copy(grayBand, true);
+        dstLaplacian.copy(grayBand, true);
+
+        applyEdgeFilter(&grayBand, &dstPrewitt, PREWITT);
+        applyEdgeFilter(&grayBand, &dstSobel, SOBEL);
+        applyLaplacianFilter(&grayBand, &dstLaplacian);
+
+        writer[0].writeBand(grayBand, range);
+        writer[1].writeBand(dstPrewitt, range);
+        writer[2].writeBand(dstSobel, range);
+        writer[3].writeBand(dstLaplacian, range);
+    }
+
+    for (int i = 0; i < 4; i++)
+        writer[i].close();
+}
+
 int main(int argc, char *argv[]) {
 
-    if (argc != 2){
-        cerr << "Usage ./prog filename(without .bmp)" << endl;
+    // --probe: ヘッダーのみを読み込み、画像情報を一覧表示
+    if (argc >= 2 && string(argv[1]) == "--probe")
+        return probeFiles(argc - 2, argv + 2);
+
+    if (argc != 2 && argc != 3){
+        cerr << "Usage ./prog filename(without .bmp) [band_rows]" << endl;
+        cerr << "      ./prog --probe file.bmp..." << endl;
         return -1;
     }
 
@@ -174,8 +208,16 @@ int main(int argc, char *argv[]) {
     string sobelFilter_filename = "dst/" + string(argv[1]) + "_sobelFilter.bmp";
     string laplacianFilter_filename = "dst/" + string(argv[1]) + "_laplacianFilter.bmp";
 
+    // 行数が指定されたときは帯単位で処理 (画像全体をメモリに載せない)
+    if (argc == 3) {
+        string dst_filenames[4] = {gray_filename, prewittFilter_filename, sobelFilter_filename, laplacianFilter_filename};
+        applyFiltersByBand(src_filename, dst_filenames, atoi(argv[2]));
+        return 0;
+    }
+
     // Bitmap
-    BitmapManager src, dstPrewitt, dstSobel, dstLaplacian;
+    BitmapManager src;
+    GrayImage gray, dstPrewitt, dstSobel, dstLaplacian;
 
     //! for color2Grayscale
     int count[256] = {0};
@@ -185,24 +227,24 @@ int main(int argc, char *argv[]) {
     src.displayHeader();
 
     // グレースケール化
-    color2Grayscale(&src, count);
-    src.writeData(gray_filename);
+    color2Grayscale(&src, &gray, count);
+    gray.writeData(gray_filename);
 
     // 画像をコピー
-    dstPrewitt.copy(src);
-    dstSobel.copy(src);
-    dstLaplacian.copy(src);
+    dstPrewitt.copy(gray, true);
+    dstSobel.copy(gray, true);
+    dstLaplacian.copy(gray, true);
 
     // prewittフィルタ適用
-    applyEdgeFilter(&src, &dstPrewitt, PREWITT);
+    applyEdgeFilter(&gray, &dstPrewitt, PREWITT);
     dstPrewitt.writeData(prewittFilter_filename);
 
     // sobelフィルタ適用
-    applyEdgeFilter(&src, &dstSobel, SOBEL);
+    applyEdgeFilter(&gray, &dstSobel, SOBEL);
     dstSobel.writeData(sobelFilter_filename);
 
     // Laplacianフィルタ適用
-    applyLaplacianFilter(&src, &dstLaplacian);
+    applyLaplacianFilter(&gray, &dstLaplacian);
     dstLaplacian.writeData(laplacianFilter_filename);
 
     return 0;
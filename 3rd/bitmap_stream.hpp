@@ -0,0 +1,86 @@
+#ifndef BITMAP_STREAM_HPP
+#define BITMAP_STREAM_HPP
+
+#include "bitmap_manager.hpp"
+#include "gray_image.hpp"
+
+/**
+ * @brief 帯の範囲を定義
+ * @details 行番号はすべて元画像の行 (ファイル上の並び順) で表す
+ */
+typedef struct BandRange {
+    int firstRow;  // 帯画像の0行目に対応する元画像の行 (上下の余白を含む)
+    int startRow;  // 出力対象の先頭行
+    int rows;  // 出力対象の行数
+} BandRange;
+
+/**
+ * @brief ビットマップを帯(複数行)単位で読み込むクラス
+ * @details 画像全体をメモリに載せず、bandRows行ずつBitmapManagerへ読み込む。
+ *          近傍処理用に上下haloRows行の余白を付けて読み込むため、3x3フィルタではhalo=1、
+ *          5x5フィルタではhalo=2とすれば、帯の境界でも画像全体に適用した場合と同じ結果になる
+ */
+class BitmapBandReader {
+    // フィールド定義
+    FILE *file;
+    FileHeader fileHeader;
+    InfoHeader infoHeader;
+    int stride;  // 1行あたりのバイト数
+    int bandRows;  // 1つの帯の行数
+    int haloRows;  // 上下の余白の行数
+    int nextRow;  // 次に読み込む帯の先頭行
+
+public:
+    // コンストラクタ
+    BitmapBandReader() {
+        file = nullptr;
+        stride = bandRows = haloRows = nextRow = 0;
+    }
+
+    // デストラクタ
+    ~BitmapBandReader() {
+        close();
+    }
+
+    // メソッド定義
+    bool open(std::string filename, int bandRows, int haloRows);  // ファイルを開き、ヘッダーを読み込む
+    bool readBand(BitmapManager &band, BandRange &range);  // 次の帯を読み込む
+    void close();
+    int getWidth();
+    int getHeight();
+};
+
+/**
+ * @brief ビットマップを帯(複数行)単位で書き出すクラス
+ * @details BitmapBandReaderで読み込んだ帯のうち、出力対象の行だけを先頭から順に追記する。
+ *          24bit画像はBitmapManager、8bit画像はGrayImageの帯を書き出す
+ */
+class BitmapBandWriter {
+    // フィールド定義
+    FILE *file;
+    int stride;  // 1行あたりのバイト数
+    int height;  // 画像全体の高さ
+    int writtenRows;  // 書き出し済みの行数
+
+    bool writeRows(const uint8_t *begin, BandRange range);
+
+public:
+    // コンストラクタ
+    BitmapBandWriter() {
+        file = nullptr;
+        stride = height = writtenRows = 0;
+    }
+
+    // デストラクタ
+    ~BitmapBandWriter() {
+        close();
+    }
+
+    // メソッド定義
+    bool open(std::string filename, int width, int height, int bitParPixel = 24);  // ファイルを開き、ヘッダーを書き出す
+    bool writeBand(BitmapManager &band, BandRange range);  // 帯の出力対象の行を書き出す (24bit)
+    bool writeBand(GrayImage &band, BandRange range);  // 帯の出力対象の行を書き出す (8bit)
+    bool close();
+};
+
+#endif // BITMAP_STREAM_HPP
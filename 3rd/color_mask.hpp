@@ -0,0 +1,28 @@
+#ifndef COLOR_MASK_HPP
+#define COLOR_MASK_HPP
+
+#include <string>
+#include "gray_image.hpp"
+
+/**
+ * @brief 色で領域を切り出すときの色空間
+ */
+enum ColorSpace {
+    COLOR_HSV,   // H (0〜179、2度単位), S, V
+    COLOR_YCBCR  // Y, Cb, Cr
+};
+
+/**
+ * @brief 色空間の各成分の範囲 (両端を含む)
+ * @details HSVのHは low > high のとき、0度をまたぐ範囲 (high以下またはlow以上) とみなす
+ */
+struct ColorRange {
+    int low[3];
+    int high[3];
+};
+
+bool parseColorSpace(std::string name, ColorSpace &space);  // "hsv", "ycbcr"
+bool parseColorRange(std::string text, ColorRange &range);  // "l0,l1,l2:h0,h1,h2"
+void applyColorMask(BitmapManager &src, GrayImage &mask, ColorSpace space, const ColorRange &range);  // 範囲内を255、それ以外を0とした2値画像
+
+#endif // COLOR_MASK_HPP
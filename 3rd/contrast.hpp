@@ -0,0 +1,25 @@
+#ifndef CONTRAST_HPP
+#define CONTRAST_HPP
+
+#include <string>
+#include "gray_image.hpp"
+
+//! @def CLAHEの既定値
+#define CLAHE_TILES 8  // 縦横それぞれのタイルの数
+#define CLAHE_CLIP 2.0  // 度数の上限 (タイル内の1階調あたりの平均度数に対する倍率)
+
+/**
+ * @brief 2値化・平滑化の前に行うコントラストの補正
+ */
+enum ContrastMode {
+    CONTRAST_NONE,
+    CONTRAST_EQUALIZE,  // ヒストグラム平坦化 (画像全体で1つの変換表)
+    CONTRAST_CLAHE      // タイルごとの平坦化 (度数の上限つき、変換表を双線形補間)
+};
+
+bool parseContrastOption(std::string option, ContrastMode &mode);  // "--equalize", "--clahe"
+void applyEqualization(GrayImage &img, const int *hist = nullptr);  // hist: 画像のヒストグラム (nullptrなら集計する)
+void applyClahe(GrayImage &img, int tiles = CLAHE_TILES, double clipLimit = CLAHE_CLIP);
+void applyContrast(GrayImage &img, ContrastMode mode, int *hist = nullptr);  // 補正後のヒストグラムでhistを置き換える
+
+#endif // CONTRAST_HPP
@@ -0,0 +1,76 @@
+#ifndef GRAY_IMAGE_HPP
+#define GRAY_IMAGE_HPP
+
+#include "bitmap_manager.hpp"
+
+/**
+ * @brief 1チャンネル8bitのグレイスケール画像クラス
+ * @details グレイスケール化以降の処理用。BitmapManagerのように同じ値をB, G, Rの3バイトへ持たないため、
+ *          メモリ量と読み書きするデータ量が1/3になる。各行は8bitビットマップと同じく4バイト境界に揃えて保持する
+ */
+class GrayImage {
+    // フィールド定義
+    uint8_t *image;  // buffer->getData()を保持したもの
+    PixelBufferPtr buffer;
+    int width;
+    int height;
+    int stride;  // 1行あたりのバイト数
+
+public:
+    // コンストラクタ
+    GrayImage() {
+        image = nullptr;
+        width = height = stride = 0;
+    }
+
+    // ムーブ (画素データの所有権を移す)。コピーはcopy()で明示的に行う
+    GrayImage(GrayImage &&src);
+    GrayImage &operator=(GrayImage &&src);
+    GrayImage(const GrayImage &) = delete;
+    GrayImage &operator=(const GrayImage &) = delete;
+
+    // メソッド定義
+    void create(int width, int height);  // 指定サイズの画像を生成 (画素値は0)
+    void fromBitmap(BitmapManager &src);  // グレイスケール化済みの24bit画像から生成 (Rの値を用いる)
+    void fromColor(BitmapManager &src, int *histogram = nullptr);  // カラー画像をグレイスケール化して生成 (画素値の度数をhistogramへ加算)
+    void toBitmap(BitmapManager &dst);  // 24bit画像へ変換
+    void writeData(std::string filename, WriteFormat format = WRITE_DEFAULT);  // 既定は8bitパレット形式で書き出し
+    void encode(EncodedBitmap &, WriteFormat format = WRITE_DEFAULT);  // 書き出し用にヘッダーと画素データをまとめる
+    void copy(GrayImage &src, bool copyOnWrite = false);  // copyOnWrite: 書き込まれるまで画素データを共有
+    int getHeight();  // 画像の高さの大きさを取得
+    int getWidth();  // 画像の幅の大きさを取得
+    int getStride();  // 1行あたりのバイト数を取得
+    int getValue(int row, int col);  // 指定した画素の値を取得
+    void setValue(int row, int col, int value);  // 指定した画素へ値を設定
+
+    // 行単位のアクセス (範囲確認は行わない)
+    // getRowは共有中の画素データを取得時に複製する。得たポインタは、その後にcopy(…, true)やencode()
+    // (AsyncWriter::write()を含む) で画素データを共有すると無効になる (書き込むと共有先の画像も変わる)。
+    // 共有した後に書き込むときは、getRowで取得し直すこと。読み込みのみの場合はgetConstRowを用いる
+    uint8_t *getRow(int row);  // 指定した行の先頭を取得
+    const uint8_t *getConstRow(int row);  // 読み込み用 (共有中の画素データを複製しない)
+
+    // 画素データを他の画像と共有しているとき、書き込み前に複製する。
+    // 共有の判定はbuffer.use_count()のみで行う。AsyncWriterは別スレッドで参照を保持・解放するため、この値はその時点の
+    // 目安に過ぎない (解放の直後でも共有中に見え、余分に複製することがある)。それでも安全なのは、copy(…, true)の相手は
+    // 書き込む前に自身で複製し、書き出しのために保持する側 (encode()の結果、AsyncWriter) は読むだけで書き込まないため。
+    // 書き込む共有者を追加するときは、use_count()ではなく共有を明示的に管理すること
+    void prepareWrite() {
+        if (buffer.use_count() > 1)
+            detach();
+    }
+
+    // 範囲確認を行わない画素アクセス (畳み込みなどのループ内で用いる)
+    // setValueUncheckedは共有中の画素データを複製しないため、ループの前にprepareWrite()を呼んでおくこと
+    int getValueUnchecked(int row, int col) {
+        return image[row * stride + col];
+    }
+    void setValueUnchecked(int row, int col, int value) {
+        image[row * stride + col] = value;
+    }
+
+private:
+    void detach();
+};
+
+#endif // GRAY_IMAGE_HPP
@@ -0,0 +1,157 @@
+#include "point_op.hpp"
+#include "parallel.hpp"
+#include "pixel_convert.hpp"
+#include <cmath>
+
+using namespace std;
+
+/**
+ * @fn 実数を四捨五入して0〜255に収める
+ */
+static uint8_t clampToByte(double value) {
+    if (value <= 0.0)
+        return 0;
+    if (value >= 255.0)
+        return 255;
+    return (uint8_t)(value + 0.5);
+}
+
+/**
+ * @fn 恒等変換で初期化する
+ */
+PointOps::PointOps() {
+    for (int value = 0; value < 256; value++)
+        table[value] = value;
+}
+
+/**
+ * @fn 線形変換を追加する
+ * @param gain 倍率
+ * @param offset 加える値
+ * @return 自身
+ */
+PointOps &PointOps::scale(double gain, double offset) {
+    uint8_t next[256];
+    for (int value = 0; value < 256; value++)
+        next[value] = clampToByte(value * gain + offset);
+
+    return lookup(next);
+}
+
+/**
+ * @fn ガンマ補正を追加する
+ * @param gamma 指数 (1未満で明るく、1より大きいと暗くなる。0以下のときは何もしない)
+ * @return 自身
+ */
+PointOps &PointOps::gamma(double gamma) {
+    if (gamma <= 0.0)
+        return *this;
+
+    uint8_t next[256];
+    for (int value = 0; value < 256; value++)
+        next[value] = clampToByte(255.0 * pow(value / 255.0, gamma));
+
+    return lookup(next);
+}
+
+/**
+ * @fn 階調の反転を追加する
+ * @return 自身
+ */
+PointOps &PointOps::invert() {
+    for (int value = 0; value < 256; value++)
+        table[value] = 255 - table[value];
+
+    return *this;
+}
+
+/**
+ * @fn 2値化を追加する
+ * @param threshold しきい値 (これを下回れば0、それ以外は255)
+ * @return 自身
+ */
+PointOps &PointOps::threshold(int threshold) {
+    return quantize(vector<int>(1, threshold));
+}
+
+/**
+ * @fn 多値化を追加する
+ * @details 画素値以下のしきい値の数をkとして、k * 255 / しきい値の数 に置き換える
+ * @param thresholds しきい値 (昇順。空のときは何もしない)
+ * @return 自身
+ */
+PointOps &PointOps::quantize(const vector<int> &thresholds) {
+    if (thresholds.empty())
+        return *this;
+
+    uint8_t next[256];
+    for (int value = 0; value < 256; value++) {
+        int level = 0;
+        while (level < (int)thresholds.size() && value >= thresholds[level])
+            level++;
+        next[value] = level * 255 / thresholds.size();
+    }
+
+    return lookup(next);
+}
+
+/**
+ * @fn 任意の変換表を追加する
+ * @details これまでの変換表の各出力を next で引き直し、1つの変換表に合成する
+ * @param next 変換表 [0 256)
+ * @return 自身
+ */
+PointOps &PointOps::lookup(const uint8_t *next) {
+    for (int value = 0; value < 256; value++)
+        table[value] = next[table[value]];
+
+    return *this;
+}
+
+/**
+ * @fn 別の演算列を続ける
+ * @param next 続ける演算列
+ * @return 自身
+ */
+PointOps &PointOps::then(const PointOps &next) {
+    return lookup(next.getTable());
+}
+
+/**
+ * @fn 合成した変換表を取得
+ * @return 変換表 [0 256)
+ */
+const uint8_t *PointOps::getTable() const {
+    return table;
+}
+
+/**
+ * @fn 合成した変換表を画像へ適用する
+ * @param img 対象画像
+ */
+void PointOps::apply(GrayImage &img) const {
+    applyLookupTable(img, table);
+}
+
+/**
+ * @fn 変換表に従って画素値を置き換える
+ * @details 1行ずつ表引き (convertByTable) で置き換え、行を分けて並列に処理する
+ * @param img 対象画像
+ * @param table 変換表 [0 256)
+ */
+void applyLookupTable(GrayImage &img, const uint8_t *table) {
+    if (img.getWidth() == 0 || img.getHeight() == 0)
+        return;
+
+    //! 出力先の先頭と1行あたりのバイト数 (スレッド内でgetRowを呼ばないよう先に取得)
+    uint8_t *data = img.getRow(0);
+    int stride = img.getStride();
+    int width = img.getWidth();
+
+    parallelFor(0, img.getHeight(), [&](int first, int last, int) {
+        for (int row = first; row < last; row++) {
+            uint8_t *line = data + (size_t)row * stride;
+            convertByTable(line, line, table, width);
+        }
+    });
+}
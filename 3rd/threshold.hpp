@@ -0,0 +1,54 @@
+#ifndef THRESHOLD_HPP
+#define THRESHOLD_HPP
+
+#include <vector>
+#include "gray_image.hpp"
+#include "integral_image.hpp"
+
+/**
+ * @brief 判別分析法 (大津の方法) によるしきい値の決定
+ * @details ヒストグラムの累積度数・累積和を一度だけ求め、以降は各しきい値候補のクラスの画素数・合計を
+ *          O(1)で引く。同じヒストグラムから2値化と多値化のしきい値をそれぞれ求められる。
+ *          getThresholdsのしきい値は上のクラスの最小値で、applyThresholds (t以上を上の段階とする) でそのまま適用できる。
+ *          getThresholdはこれまでどおり「t以下」を下のクラスとして求め、2値化ではtを下回る画素を0とする
+ */
+class OtsuThreshold {
+    // フィールド定義
+    long long cumCount[256];  // [0, i] の画素数
+    long long cumSum[256];  // [0, i] の画素値の合計
+
+public:
+    // コンストラクタ
+    explicit OtsuThreshold(const int *hist);  // hist: ヒストグラム [0 256)
+
+    // メソッド定義
+    int getThreshold();  // 2値化のしきい値 (O(256))
+    std::vector<int> getThresholds(int count);  // 多値化のしきい値 count個 (1〜4、昇順。各クラスの最小値)
+
+private:
+    long long countBetween(int first, int last);  // [first, last] の画素数
+    long long sumBetween(int first, int last);  // [first, last] の画素値の合計
+};
+
+void applyThresholds(GrayImage &img, const std::vector<int> &thresholds);  // しきい値で多値化 (1個なら2値化)
+
+//! @def 適応的2値化の係数
+#define NIBLACK_K (-0.2)  // T = m + k * s
+#define SAUVOLA_K 0.2  // T = m * (1 + k * (s / R - 1))
+#define SAUVOLA_R 128.0
+#define BRADLEY_T 0.15  // T = m * (1 - t)
+#define ADAPTIVE_WINDOW 31  // 窓の一辺 (既定値)
+
+/**
+ * @brief 適応的2値化の方法 (各画素の周囲の平均m・標準偏差sからしきい値Tを決める)
+ */
+enum AdaptiveMethod {
+    ADAPTIVE_NIBLACK,
+    ADAPTIVE_SAUVOLA,
+    ADAPTIVE_BRADLEY
+};
+
+bool parseAdaptiveMethod(std::string name, AdaptiveMethod &method);  // "niblack", "sauvola", "bradley"
+void applyAdaptiveThreshold(GrayImage &img, AdaptiveMethod method, int window);  // 一辺windowの窓で適応的に2値化
+
+#endif // THRESHOLD_HPP
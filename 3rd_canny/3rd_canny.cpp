@@ -1,5 +1,9 @@
 #define _USE_MATH_DEFINES
 #include "bitmap_manager.hpp"
+#include "gray_image.hpp"
+#include "async_writer.hpp"
+#include "contrast.hpp"
+#include "filter.hpp"
 
 using namespace std;
 
@@ -52,76 +56,25 @@ public:
 
 /**
  * @fn カラー画像をグレイスケール画像へ変換
+ * @details 0.3R + 0.59G + 0.11B を固定小数点で求める。変換とヒストグラムの集計は行を分けて並列に行う
  * @param bmp ビットマップマネージャー
+ * @param gray 出力先のグレイスケール画像
  * @count ヒストグラム用の配列 [0 256)
  */
-void color2Grayscale(BitmapManager *bmp, int *count) {
-    //! 各色に乗ずる係数
-    const float c_r = 0.3;
-    const float c_g = 0.59;
-    const float c_b = 0.11;
-
-    //! 各画素の色を保存する変数
-    Color color;
-    //! カラー画素から生成したグレイスケールの値
-    int grayValue;
-
-    for (int row = 0; row < bmp->getHeight(); row++){
-        for (int col = 0; col < bmp->getWidth(); col++){
-            // カラー取得
-            color = bmp->getColor(row, col);
-
-            // 変換式によってグレースケールへ変換
-            grayValue = (int)(c_r * color.r + c_g * color.g + c_b * color.b);
-
-            // 求めたグレースケール値をセット
-            bmp->setColor(row, col, grayValue, grayValue, grayValue);
-
-            // ヒストグラム用にグレースケール値をカウント
-            count[grayValue]++;
-        }
-    }
+void color2Grayscale(BitmapManager *bmp, GrayImage *gray, int *count) {
+    gray->fromColor(*bmp, count);
 }
 
 /**
  * @fn 5x5 ガウシアンフィルタを適用
+ * @details 2項係数 (1 4 6 4 1) を横・縦の2回に分けて整数で厳密に掛ける (applySeparableGaussian)。
+ *          25回の積和/画素が10回になり、結果は5x5の重みで畳み込んだものと同じになる
  * @param src 元画像
  * @count dst 結果画像
  */
-void applyGaussianFilter5x5(BitmapManager *src, BitmapManager *dst){
-    //! 各画素の計算用(和、平均値)
-    int sum=0, ave=0;
-
-    //! 各画素にかけるフィルターの重み
-    int w[5][5] = { 1,  4,  6,  4,  1,
-                    4, 16, 24, 16,  4,
-                    6, 24, 36, 24,  6,
-                    4, 16, 24, 16,  4,
-                    1,  4,  6,  4,  1};
-
-    for (int row = 2; row < src->getHeight()-2; row++) {
-        for (int col = 2; col < src->getWidth()-2; col++) {
-
-            // 画素値取得、周囲の画素を取り込む、wをかけることで重みもつける
-            for (int innerRow = -2; innerRow <= 2; innerRow++) {
-                for (int innerCol = -2; innerCol <= 2; innerCol++) {
-                    sum += src->getColor(row+innerRow, col+innerCol).r * w[innerRow+2][innerCol+2];
-                }
-            }
-
-            // 平均を出す
-            ave = sum / 256;
+void applyGaussianFilter5x5(GrayImage *src, GrayImage *dst){
+    applySeparableGaussian(*src, *dst, makeBinomialKernel(5));
 
-            // for debug
-            //cout << ave << endl;
-
-            // set
-            dst->setColor(row, col, ave, ave, ave);
-
-            // 変数リセット
-            sum = ave = 0;
-        }
-    }
     // for debug
     cout << "Completed: gaussianFilter" << endl;
 }
@@ -132,7 +85,7 @@ void applyGaussianFilter5x5(BitmapManager *src, BitmapManager *dst){
  * @param dst 結果画像
  * @param dstAtan Arctanによる勾配方向の情報
  */
-void applySobelFilter(BitmapManager *src, BitmapManager *dst, Angle angle){
+void applySobelFilter(GrayImage *src, GrayImage *dst, Angle angle){
     //! 各画素の計算用(x, y, total)
     int gx = 0, gy = 0, g = 0;
     auto theta = 0;
@@ -153,8 +106,8 @@ void applySobelFilter(BitmapManager *src, BitmapManager *dst, Angle angle){
             // 画素値取得、周囲の画素を取り込む、wx, wyをかけることで重みもつける
             for (int innerRow = -1; innerRow <= 1; innerRow++) {
                 for (int innerCol = -1; innerCol <= 1; innerCol++) {
-                    gx += src->getColor(row+innerRow, col+innerCol).r * sobel_wx[innerRow+1][innerCol+1];
-                    gy += src->getColor(row+innerRow, col+innerCol).r * sobel_wy[innerRow+1][innerCol+1];
+                    gx += src->getValue(row+innerRow, col+innerCol) * sobel_wx[innerRow+1][innerCol+1];
+                    gy += src->getValue(row+innerRow, col+innerCol) * sobel_wy[innerRow+1][innerCol+1];
                 }
             }
 
@@ -168,7 +121,7 @@ void applySobelFilter(BitmapManager *src, BitmapManager *dst, Angle angle){
             theta = atan2(gy, gx) * 180 / M_PI;
 
             // set
-            dst->setColor(row, col, g, g, g);
+            dst->setValue(row, col, g);
             angle.setData(row, col, theta);
             // cout << "(" << row << ", " << col << "): " << theta << ", " << angle.getData(row, col) << endl;
 
@@ -188,7 +141,7 @@ void applySobelFilter(BitmapManager *src, BitmapManager *dst, Angle angle){
  * @param srcAtan 方向値を保持した画像
  * @param dst 最大値抑制をかけたソーベルフィルタ画像
  */
-void nonMaximumSuppression(BitmapManager* srcSobel, Angle angle, BitmapManager* dst) {
+void nonMaximumSuppression(GrayImage* srcSobel, Angle angle, GrayImage* dst) {
 
     //! 4方向の定義, 上下、左右、右上がり、左上がりを定義
     const int dir_0_180 = 0;
@@ -231,33 +184,36 @@ void nonMaximumSuppression(BitmapManager* srcSobel, Angle angle, BitmapManager*
 
     // 勾配方向の隣接マスを確認し、極大値でなければ0を代入
     for (int row = 1; row < srcSobel->getHeight()-1; row++) {
+        //! 注目画素の上の行、注目画素の行、下の行
+        const uint8_t *above = srcSobel->getConstRow(row-1);
+        const uint8_t *center = srcSobel->getConstRow(row);
+        const uint8_t *below = srcSobel->getConstRow(row+1);
+        //! 出力先の行
+        uint8_t *dstRow = dst->getRow(row);
+
         for (int col = 1; col < srcSobel->getWidth()-1; col++) {
             interestedPixel = angle.getData(row, col);
 
             switch (interestedPixel) {
                 // 左右
                 case dir_0_180:
-                    if (srcSobel->getColor(row, col).r < srcSobel->getColor(row-1, col).r
-                        || srcSobel->getColor(row, col).r < srcSobel->getColor(row+1, col).r)
-                        dst->setColor(row, col, 0, 0, 0);
+                    if (center[col] < above[col] || center[col] < below[col])
+                        dstRow[col] = 0;
                     break;
                 // 右上がり方向
                 case dir_45_225:
-                    if (srcSobel->getColor(row, col).r < srcSobel->getColor(row-1, col-1).r
-                        || srcSobel->getColor(row, col).r < srcSobel->getColor(row+1, col+1).r)
-                        dst->setColor(row, col, 0, 0, 0);
+                    if (center[col] < above[col-1] || center[col] < below[col+1])
+                        dstRow[col] = 0;
                     break;
                 // 上下方向
                 case dir_90_270:
-                    if (srcSobel->getColor(row, col).r < srcSobel->getColor(row, col-1).r
-                        || srcSobel->getColor(row, col).r < srcSobel->getColor(row, col+1).r)
-                        dst->setColor(row, col, 0, 0, 0);
+                    if (center[col] < center[col-1] || center[col] < center[col+1])
+                        dstRow[col] = 0;
                     break;
                 // 左上がり方向
                 case dir_135_305:
-                    if (srcSobel->getColor(row, col).r < srcSobel->getColor(row+1, col-1).r
-                        || srcSobel->getColor(row, col).r < srcSobel->getColor(row-1, col+1).r)
-                        dst->setColor(row, col, 0, 0, 0);
+                    if (center[col] < below[col-1] || center[col] < above[col+1])
+                        dstRow[col] = 0;
                     break;
                 default:
                     cerr << "Error: nonMaximumSuppression: Suppression" << endl;
@@ -278,12 +234,12 @@ void nonMaximumSuppression(BitmapManager* srcSobel, Angle angle, BitmapManager*
  * @param t_upper 上側のエッジしきい値
  * @return エッジとして採用してよいかどうか (t or f)
  */
-bool checkAdoptedEdge(BitmapManager* src, int row, int col, int t_upper) {
+bool checkAdoptedEdge(GrayImage* src, int row, int col, int t_upper) {
     
     for (int innerRow = -1; innerRow <= 1; innerRow++) {
         for (int innerCol = -1; innerCol <= 1; innerCol++) {
             // 隣接8方向に上側のエッジしきい値を超えるものがあればtrueを返す
-            if (src->getColor(row+innerRow, col+innerCol).r >= t_upper)
+            if (src->getValue(row+innerRow, col+innerCol) >= t_upper)
                 return true;
         }
     }
@@ -298,19 +254,19 @@ bool checkAdoptedEdge(BitmapManager* src, int row, int col, int t_upper) {
  * @param t_upper しきい値(上)
  * @param t_lower しきい値(下)
  */
-void hysteresisThreshold(BitmapManager* src, BitmapManager* dst, int t_upper, int t_lower) {
+void hysteresisThreshold(GrayImage* src, GrayImage* dst, int t_upper, int t_lower) {
     bool isAdoptedEdge = false;
 
     for (int row = 1; row < src->getHeight()-1; row++) {
         for (int col = 1; col < src->getWidth()-1; col++) {
             // 上側は輪郭として採用
-            if (src->getColor(row, col).r >= t_upper) {
-                dst->setColor(row, col, 255, 255, 255);
+            if (src->getValue(row, col) >= t_upper) {
+                dst->setValue(row, col, 255);
             }
 
             // 下側は不採用
-            else if (src->getColor(row, col).r < t_lower) {
-                dst->setColor(row, col, 0, 0, 0);
+            else if (src->getValue(row, col) < t_lower) {
+                dst->setValue(row, col, 0);
             }
 
             // 上側と下側の間なら、周囲に採用される (t_upperよりも大きい) 値があれば採用
@@ -318,9 +274,9 @@ void hysteresisThreshold(BitmapManager* src, BitmapManager* dst, int t_upper, in
                 isAdoptedEdge = checkAdoptedEdge(src, row, col, t_upper);
 
                 if (isAdoptedEdge == true)
-                    dst->setColor(row, col, 255, 255, 255);
+                    dst->setValue(row, col, 255);
                 if (isAdoptedEdge == false)
-                    dst->setColor(row, col, 0, 0, 0);
+                    dst->setValue(row, col, 0);
 
                 isAdoptedEdge = false;
             }
@@ -332,22 +288,26 @@ void hysteresisThreshold(BitmapManager* src, BitmapManager* dst, int t_upper, in
 
 
 
-int main(int argc, char *argv[]) {
-
-    if (argc != 2){
-        cerr << "Usage ./prog filename(without .bmp)" << endl;
-        return -1;
-    }
-
+/**
+ * @fn 1枚の画像にCannyエッジ検出を適用し、中間画像をすべて出力する
+ * @details 各段階の出力は書き出し用スレッドへ渡し、書き出しと次の段階の処理を重ねる
+ * @param name ファイル名 (.bmpなし)
+ * @param contrast 平滑化の前に行うコントラストの補正
+ * @param sigma 平滑化の標準偏差 (0のときは5x5ガウシアンフィルタ、それ以外は再帰型ガウシアンフィルタ)
+ * @param check 再帰型のときに、FIRのガウシアンフィルタとの差を表示するかどうか
+ * @param writer 書き出し用スレッド
+ */
+void applyCanny(string name, ContrastMode contrast, double sigma, bool check, AsyncWriter &writer) {
     //! ファイル名
-    string src_filename = "src/" + string(argv[1]) + ".bmp";
-    string gauss_filename = "dst/" + string(argv[1]) + "_gauss.bmp";
-    string sobel_filename = "dst/" + string(argv[1]) + "_sobel.bmp";
-    string sup_filename = "dst/" + string(argv[1]) + "_sup.bmp";
-    string canny_filename = "dst/" + string(argv[1]) + "_canny.bmp";
+    string src_filename = "src/" + name + ".bmp";
+    string gauss_filename = "dst/" + name + "_gauss.bmp";
+    string sobel_filename = "dst/" + name + "_sobel.bmp";
+    string sup_filename = "dst/" + name + "_sup.bmp";
+    string canny_filename = "dst/" + name + "_canny.bmp";
 
     // Bitmap
-    BitmapManager src, imgGauss, imgSobel, imgSuppression, dst;
+    BitmapManager src;
+    GrayImage gray, imgGauss, imgSobel, imgSuppression, dst;
 
     //! for color2Grayscale
     int count[256] = {0};
@@ -357,32 +317,94 @@ int main(int argc, char *argv[]) {
     src.displayHeader();
 
     // グレースケール化
-    color2Grayscale(&src, count);
+    color2Grayscale(&src, &gray, count);
     // src.writeData(gray_filename);
 
     // atan用Angle宣言
     Angle angle;
     angle.setSize(src.getWidth(), src.getHeight());
 
-    // 処理
-    // 1. 5x5 ガウシアンフィルタ適用
-    imgGauss.copy(src);
-    applyGaussianFilter5x5(&src, &imgGauss);
+    // 処理 (中間画像は得られた時点で書き出しを予約する)
+    // 0. コントラストの補正 (指定したときのみ)
+    applyContrast(gray, contrast);
+    // 1. ガウシアンフィルタ適用 (sigma指定時は大きなsigmaでも処理時間が変わらない再帰型)
+    if (sigma > 0.0) {
+        applyRecursiveGaussian(gray, imgGauss, sigma);
+        if (check) {
+            // 同じsigmaのFIRのフィルタとの差 (FIRが処理しない端は除く)
+            GaussianKernel kernel = makeGaussianKernel(sigma);
+            GrayImage fir;
+            applySeparableGaussian(gray, fir, kernel);
+            ImageDifference difference = compareImages(imgGauss, fir, kernel.radius);
+            cout << "recursive gaussian vs FIR: max " << difference.maxError << ", mean " << difference.meanError << endl;
+        }
+    } else {
+        imgGauss.copy(gray, true);
+        applyGaussianFilter5x5(&gray, &imgGauss);
+    }
+    writer.write(gauss_filename, imgGauss);
     // 2. ソーベルフィルタ適用
-    imgSobel.copy(imgGauss);
+    imgSobel.copy(imgGauss, true);
     applySobelFilter(&imgGauss, &imgSobel, angle);
+    writer.write(sobel_filename, imgSobel);
     // 3. 最大値抑制
-    imgSuppression.copy(imgSobel);
+    imgSuppression.copy(imgSobel, true);
     nonMaximumSuppression(&imgSobel, angle, &imgSuppression);
+    writer.write(sup_filename, imgSuppression);
     // 4. ヒステリシスのしきい値適用
-    dst.copy(imgSuppression);
+    dst.copy(imgSuppression, true);
     hysteresisThreshold(&imgSuppression, &dst, T_UPPER, T_LOWER);
+    writer.write(canny_filename, dst, WRITE_RLE8);
+}
+
+int main(int argc, char *argv[]) {
+
+    // --probe: ヘッダーのみを読み込み、画像情報を一覧表示
+    if (argc >= 2 && string(argv[1]) == "--probe")
+        return probeFiles(argc - 2, argv + 2);
+
+    // ファイル名より前に指定するオプション
+    // --equalize / --clahe: 平滑化の前にコントラストを補正
+    // --sigma s: 5x5ガウシアンフィルタの代わりに標準偏差sの再帰型ガウシアンフィルタを用いる (sが5以上でFIRより速い)
+    // --check: --sigma指定時に、FIRのガウシアンフィルタとの差を表示
+    ContrastMode contrast = CONTRAST_NONE;
+    double sigma = 0.0;
+    bool check = false;
+    while (argc >= 2) {
+        if (parseContrastOption(argv[1], contrast)) {
+            argc--;
+            argv++;
+        } else if (string(argv[1]) == "--sigma" && argc >= 3) {
+            sigma = atof(argv[2]);
+            argc -= 2;
+            argv += 2;
+        } else if (string(argv[1]) == "--check") {
+            check = true;
+            argc--;
+            argv++;
+        } else {
+            break;
+        }
+    }
+
+    if (argc < 2){
+        cerr << "Usage ./prog [--equalize|--clahe] [--sigma s [--check]] filename(without .bmp)..." << endl;
+        cerr << "      ./prog --probe file.bmp..." << endl;
+        cerr << "      --sigma s: recursive gaussian (faster than the FIR filter for s >= 5)" << endl;
+        return -1;
+    }
+
+    // 書き出し用スレッド (前のフレームの書き出しと次のフレームの処理を重ねる)
+    AsyncWriter writer;
+
+    for (int i = 1; i < argc; i++)
+        applyCanny(argv[i], contrast, sigma, check, writer);
+
+    // すべての書き出しを待つ
+    writer.flush();
 
-    // 中間画像をすべて出力
-    imgGauss.writeData(gauss_filename);
-    imgSobel.writeData(sobel_filename);
-    imgSuppression.writeData(sup_filename);
-    dst.writeData(canny_filename);
+    // 中間画像の領域の再利用状況
+    BufferPool::instance().displayStats();
 
-    return 0;
+    return writer.getFailedCount() == 0 ? 0 : -1;
 }
@@ -0,0 +1,217 @@
+#include "bitmap_stream.hpp"
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @fn ファイルを開き、ヘッダーを読み込む
+ * @param filename ファイル名
+ * @param bandRows 1つの帯の行数
+ * @param haloRows 上下に付ける余白の行数 (近傍処理の半径)
+ * @return 成功したかどうか
+ */
+bool BitmapBandReader::open(string filename, int bandRows, int haloRows) {
+    close();
+
+    if (bandRows <= 0 || haloRows < 0) {
+        cout << "Error: BitmapBandReader: 帯の行数が不正" << endl;
+        return false;
+    }
+
+    // ファイルオープン
+    file = fopen(filename.c_str(), "rb");
+
+    if (file == NULL) {
+        cout << "Error: can't open " << filename << "." << endl;
+        return false;
+    }
+
+    //! ヘッダーのバイト列
+    uint8_t data[FILE_HEADER_SIZE + INFO_HEADER_SIZE];
+
+    if (fread(data, sizeof(uint8_t), sizeof data, file) != sizeof data) {
+        cout << "Error: BitmapBandReader: ヘッダーを読み込めません" << endl;
+        close();
+        return false;
+    }
+
+    parseFileHeader(data, fileHeader);
+    parseInfoHeader(data + FILE_HEADER_SIZE, fileHeader, infoHeader);
+
+    // 帯単位の読み込みは24bit・無圧縮のみ対応
+    if (infoHeader.colorParPixel != 24 || infoHeader.height <= 0) {
+        cout << "Error: BitmapBandReader: 24bitのボトムアップ形式のみ対応" << endl;
+        close();
+        return false;
+    }
+
+    this->stride = rowStride(infoHeader.width, 24);
+    this->bandRows = bandRows;
+    this->haloRows = haloRows;
+    this->nextRow = 0;
+
+    return true;
+}
+
+/**
+ * @fn 次の帯を読み込む
+ * @details bandには余白を含めた行が格納される。画像の上端・下端では余白を付けない
+ * @param band 読み込み先 (帯のサイズで作り直される)
+ * @param range 読み込んだ帯の範囲
+ * @return 帯を読み込めたかどうか (最後の帯を読み終えたらfalse)
+ */
+bool BitmapBandReader::readBand(BitmapManager &band, BandRange &range) {
+    if (file == NULL || nextRow >= infoHeader.height)
+        return false;
+
+    range.startRow = nextRow;
+    range.rows = min(bandRows, infoHeader.height - nextRow);
+    range.firstRow = max(0, range.startRow - haloRows);
+
+    //! 余白を含めた帯の最終行 (この行は含まない)
+    int lastRow = min(infoHeader.height, range.startRow + range.rows + haloRows);
+
+    band.create(infoHeader.width, lastRow - range.firstRow);
+
+    // 帯の先頭行まで移動して、余白を含めた行をまとめて読み込む
+    off_t pos = (off_t)fileHeader.offset + (off_t)range.firstRow * stride;
+    size_t size = (size_t)(lastRow - range.firstRow) * stride;
+
+    if (fseeko(file, pos, SEEK_SET) != 0 || fread(band.image, sizeof(uint8_t), size, file) != size) {
+        cout << "Error: BitmapBandReader: 画像データを読み込めません" << endl;
+        return false;
+    }
+
+    nextRow += range.rows;
+
+    return true;
+}
+
+/**
+ * @fn ファイルを閉じる
+ */
+void BitmapBandReader::close() {
+    if (file != NULL) {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+/**
+ * @fn width getter
+ * @return width
+ */
+int BitmapBandReader::getWidth() {
+    return infoHeader.width;
+}
+
+/**
+ * @fn height getter
+ * @return height
+ */
+int BitmapBandReader::getHeight() {
+    return infoHeader.height;
+}
+
+/**
+ * @fn ファイルを開き、ヘッダーを書き出す
+ * @param filename ファイル名
+ * @param width 画像全体の幅
+ * @param height 画像全体の高さ
+ * @param bitParPixel 1ピクセルあたりのビット数 (24 or 8)
+ * @return 成功したかどうか
+ */
+bool BitmapBandWriter::open(string filename, int width, int height, int bitParPixel) {
+    close();
+
+    file = fopen(filename.c_str(), "wb");
+
+    if (file == NULL) {
+        cout << "Error: 書き出し先のファイルを開けません。" << endl;
+        return false;
+    }
+
+    FileHeader fileHeader;
+    InfoHeader infoHeader;
+    buildHeaders(width, height, bitParPixel, fileHeader, infoHeader);
+
+    fwrite(fileHeader.origData, sizeof(uint8_t), FILE_HEADER_SIZE, file);
+    fwrite(infoHeader.origData, sizeof(uint8_t), INFO_HEADER_SIZE, file);
+    if (bitParPixel <= 8)
+        writeGrayPalette(file, bitParPixel);
+
+    this->stride = rowStride(width, bitParPixel);
+    this->height = height;
+    this->writtenRows = 0;
+
+    return true;
+}
+
+/**
+ * @fn 帯のうち出力対象の行を書き出す (24bit)
+ * @param band 帯画像
+ * @param range 帯の範囲 (BitmapBandReader::readBandで得たもの)
+ * @return 成功したかどうか
+ */
+bool BitmapBandWriter::writeBand(BitmapManager &band, BandRange range) {
+    return writeRows(band.image, range);
+}
+
+/**
+ * @fn 帯のうち出力対象の行を書き出す (8bit)
+ * @param band 帯画像
+ * @param range 帯の範囲 (BitmapBandReader::readBandで得たもの)
+ * @return 成功したかどうか
+ */
+bool BitmapBandWriter::writeBand(GrayImage &band, BandRange range) {
+    return writeRows(band.getConstRow(0), range);
+}
+
+/**
+ * @fn 帯のうち出力対象の行を書き出す
+ * @details 帯は先頭から順に、重なりなく書き出す必要がある
+ * @param begin 帯画像の画素データの先頭
+ * @param range 帯の範囲
+ * @return 成功したかどうか
+ */
+bool BitmapBandWriter::writeRows(const uint8_t *begin, BandRange range) {
+    if (file == NULL)
+        return false;
+
+    if (range.startRow != writtenRows || writtenRows + range.rows > height) {
+        cout << "Error: BitmapBandWriter: 帯の順序が不正" << endl;
+        return false;
+    }
+
+    // 帯画像の中での出力対象の先頭へ移動
+    begin += (size_t)(range.startRow - range.firstRow) * stride;
+    size_t size = (size_t)range.rows * stride;
+
+    if (fwrite(begin, sizeof(uint8_t), size, file) != size) {
+        cout << "Error: BitmapBandWriter: 書き出しに失敗" << endl;
+        return false;
+    }
+
+    writtenRows += range.rows;
+
+    return true;
+}
+
+/**
+ * @fn ファイルを閉じる
+ * @return すべての行を書き出していたかどうか
+ */
+bool BitmapBandWriter::close() {
+    if (file == NULL)
+        return true;
+
+    fclose(file);
+    file = NULL;
+
+    if (writtenRows != height) {
+        cout << "Error: BitmapBandWriter: 書き出した行数が不足 (" << writtenRows << "/" << height << ")" << endl;
+        return false;
+    }
+
+    return true;
+}
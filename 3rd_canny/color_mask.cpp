@@ -0,0 +1,95 @@
+#include "color_mask.hpp"
+#include "parallel.hpp"
+#include "pixel_convert.hpp"
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @fn 名前から色空間を得る
+ * @param name 名前 ("hsv", "ycbcr")
+ * @param space 格納先
+ * @return 該当する色空間があればtrue
+ */
+bool parseColorSpace(string name, ColorSpace &space) {
+    if (name == "hsv")
+        space = COLOR_HSV;
+    else if (name == "ycbcr")
+        space = COLOR_YCBCR;
+    else
+        return false;
+
+    return true;
+}
+
+/**
+ * @fn 文字列から色の範囲を得る
+ * @param text "下限0,下限1,下限2:上限0,上限1,上限2" (例: HSVの赤 "170,100,50:10,255,255")
+ * @param range 格納先
+ * @return 読み取れて、各値が0〜255であればtrue
+ */
+bool parseColorRange(string text, ColorRange &range) {
+    //! 読み取った値の数と、最後に読んだ位置
+    int length = 0;
+    if (sscanf(text.c_str(), "%d,%d,%d:%d,%d,%d%n", &range.low[0], &range.low[1], &range.low[2],
+               &range.high[0], &range.high[1], &range.high[2], &length) != 6 || length != (int)text.size())
+        return false;
+
+    for (int i = 0; i < 3; i++) {
+        if (range.low[i] < 0 || range.low[i] > 255 || range.high[i] < 0 || range.high[i] > 255)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @fn 色の範囲に入る画素を切り出す
+ * @details 1行ずつ指定した色空間へ変換 (convertBgrToHsv, convertBgrToYcbcr) し、範囲内の画素を255、それ以外を0とする。
+ *          グレイスケール化を経ずにカラー画像から直接2値画像を作り、ラベリング (applyClassification) にそのまま渡せる。
+ *          行を分けて並列に処理する
+ * @param src カラー画像
+ * @param mask 出力先 (srcと同じ大きさで作り直される)
+ * @param space 色空間
+ * @param range 範囲
+ */
+void applyColorMask(BitmapManager &src, GrayImage &mask, ColorSpace space, const ColorRange &range) {
+    mask.create(src.getWidth(), src.getHeight());
+    if (src.getWidth() == 0 || src.getHeight() == 0)
+        return;
+
+    //! 元画像・出力先の先頭と1行あたりのバイト数 (スレッド内でgetRowを呼ばないよう先に取得)
+    const uint8_t *srcData = src.getConstRow(0);
+    int srcStride = src.getStride();
+    uint8_t *dstData = mask.getRow(0);
+    int stride = mask.getStride();
+    int width = src.getWidth();
+
+    //! Hが0度をまたぐ範囲かどうか
+    bool wrap = space == COLOR_HSV && range.low[0] > range.high[0];
+
+    parallelFor(0, src.getHeight(), [&](int first, int last, int) {
+        //! 変換後の1行
+        vector<uint8_t> converted((size_t)3 * width);
+
+        for (int row = first; row < last; row++) {
+            const uint8_t *srcRow = srcData + (size_t)row * srcStride;
+            uint8_t *dstRow = dstData + (size_t)row * stride;
+
+            if (space == COLOR_HSV)
+                convertBgrToHsv(srcRow, converted.data(), width);
+            else
+                convertBgrToYcbcr(srcRow, converted.data(), width);
+
+            for (int col = 0; col < width; col++) {
+                const uint8_t *pixel = &converted[3 * col];
+                bool inside = wrap ? (pixel[0] >= range.low[0] || pixel[0] <= range.high[0])
+                                   : (pixel[0] >= range.low[0] && pixel[0] <= range.high[0]);
+                inside = inside && pixel[1] >= range.low[1] && pixel[1] <= range.high[1]
+                         && pixel[2] >= range.low[2] && pixel[2] <= range.high[2];
+                dstRow[col] = inside ? 255 : 0;
+            }
+        }
+    });
+}
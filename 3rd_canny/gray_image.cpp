@@ -0,0 +1,289 @@
+#include "gray_image.hpp"
+#include "pixel_convert.hpp"
+#include "parallel.hpp"
+
+using namespace std;
+
+/**
+ * @fn ムーブコンストラクタ
+ * @param src 移動元 (空の状態になる)
+ */
+GrayImage::GrayImage(GrayImage &&src) {
+    image = nullptr;
+    width = height = stride = 0;
+    *this = std::move(src);
+}
+
+/**
+ * @fn ムーブ代入
+ * @param src 移動元 (空の状態になる)
+ * @return 自身
+ */
+GrayImage &GrayImage::operator=(GrayImage &&src) {
+    if (this == &src)
+        return *this;
+
+    image = src.image;
+    buffer = std::move(src.buffer);
+    width = src.width;
+    height = src.height;
+    stride = src.stride;
+
+    src.image = nullptr;
+    src.width = src.height = src.stride = 0;
+
+    return *this;
+}
+
+/**
+ * @fn 指定サイズの画像を生成する
+ * @param width 画像の幅
+ * @param height 画像の高さ
+ */
+void GrayImage::create(int width, int height) {
+    this->width = width;
+    this->height = height;
+    this->stride = rowStride(width, 8);
+
+    // すでにimageがあったら手放して確保し直す
+    buffer = std::make_shared<PixelBuffer>(stride * height);
+    image = buffer->getData();
+    memset(image, 0, stride * height);
+}
+
+/**
+ * @fn グレイスケール化済みの24bit画像から生成する
+ * @param src 元画像 (R, G, Bが同じ値であること)
+ */
+void GrayImage::fromBitmap(BitmapManager &src) {
+    create(src.getWidth(), src.getHeight());
+
+    for (int row = 0; row < height; row++) {
+        //! 元画像の行
+        const BgrPixel *srcRow = src.getConstBgrRow(row);
+        //! 出力先の行
+        uint8_t *dstRow = getRow(row);
+
+        for (int col = 0; col < width; col++) {
+            dstRow[col] = srcRow[col].r;
+        }
+    }
+}
+
+/**
+ * @fn カラー画像をグレイスケール化して生成する
+ * @details 行を複数のスレッドに分け、各スレッドは変換した行の度数を自分専用のヒストグラムに数える。
+ *          ヒストグラム同士は詰め物で離し、同じキャッシュラインへ書き込まないようにする。
+ *          最後にスレッドの順に足し合わせるため、結果はスレッド数によらず同じになる
+ * @param src 元画像 (24bit)
+ * @param histogram 画素値の度数を加算する配列 [0 256) (nullptrのときは数えない)
+ */
+void GrayImage::fromColor(BitmapManager &src, int *histogram) {
+    create(src.getWidth(), src.getHeight());
+
+    //! 元画像・出力先の先頭と1行あたりのバイト数 (スレッド内でgetRowを呼ばないよう先に取得)
+    const uint8_t *srcData = src.getConstRow(0);
+    int srcStride = src.getStride();
+    uint8_t *dstData = getRow(0);
+    int width = this->width;
+    int stride = this->stride;
+
+    //! スレッドごとのヒストグラム
+    vector<int> counts((size_t)getThreadCount() * HISTOGRAM_STRIDE, 0);
+
+    parallelFor(0, height, [&](int first, int last, int index) {
+        //! このスレッドのヒストグラム
+        int *count = &counts[(size_t)index * HISTOGRAM_STRIDE];
+
+        for (int row = first; row < last; row++) {
+            //! 出力先の行
+            uint8_t *dstRow = dstData + (size_t)row * stride;
+            convertBgrToGray(srcData + (size_t)row * srcStride, dstRow, width);
+
+            if (histogram != nullptr) {
+                for (int col = 0; col < width; col++)
+                    count[dstRow[col]]++;
+            }
+        }
+    });
+
+    if (histogram == nullptr)
+        return;
+
+    for (size_t offset = 0; offset < counts.size(); offset += HISTOGRAM_STRIDE) {
+        for (int value = 0; value < 256; value++)
+            histogram[value] += counts[offset + value];
+    }
+}
+
+/**
+ * @fn 24bit画像へ変換する
+ * @param dst 出力画像 (画像のサイズで作り直される)
+ */
+void GrayImage::toBitmap(BitmapManager &dst) {
+    dst.create(width, height);
+
+    for (int row = 0; row < height; row++) {
+        //! 元画像の行
+        const uint8_t *srcRow = getConstRow(row);
+        //! 出力先の行
+        BgrPixel *dstRow = dst.getBgrRow(row);
+
+        for (int col = 0; col < width; col++) {
+            dstRow[col].b = dstRow[col].g = dstRow[col].r = srcRow[col];
+        }
+    }
+}
+
+/**
+ * @fn ビットマップとして書き出す
+ * @details ヘッダー、パレット、画素データを1回のwritevで書き出す
+ * @param filename ファイルの名前
+ * @param format 書き出し形式 (既定は8bitパレット形式)
+ */
+void GrayImage::writeData(string filename, WriteFormat format) {
+    EncodedBitmap bmp;
+    encode(bmp, format);
+
+    writeEncodedBitmap(filename, bmp);
+}
+
+/**
+ * @fn 書き出し用にヘッダーと画素データをまとめる
+ * @details 8bitパレット形式では画素データは複製せず共有する。以降にこの画像へ書き込むと、画像側が複製を作る
+ * @param bmp 格納先
+ * @param format 書き出し形式
+ */
+void GrayImage::encode(EncodedBitmap &bmp, WriteFormat format) {
+    if (format != WRITE_DEFAULT) {
+        encodeGrayPixels(image, stride, 1, width, height, format, bmp);
+        return;
+    }
+
+    FileHeader fileHeader;
+    InfoHeader infoHeader;
+    buildHeaders(width, height, 8, fileHeader, infoHeader);
+
+    // ヘッダー、パレット
+    bmp.header.assign(fileHeader.origData, fileHeader.origData + FILE_HEADER_SIZE);
+    bmp.header.insert(bmp.header.end(), infoHeader.origData, infoHeader.origData + INFO_HEADER_SIZE);
+    appendGrayPalette(bmp.header, 8);
+
+    bmp.buffer = buffer;
+    bmp.data = image;
+    bmp.size = stride * height;
+}
+
+/**
+ * @fn 画像をコピーする
+ * @param src コピー元
+ * @param copyOnWrite trueのとき画素データを共有し、どちらかが書き込むまで複製を遅らせる (O(1))
+ */
+void GrayImage::copy(GrayImage &src, bool copyOnWrite) {
+    if (copyOnWrite) {
+        buffer = src.buffer;
+        image = src.image;
+        width = src.width;
+        height = src.height;
+        stride = src.stride;
+        return;
+    }
+
+    // 専用の領域を持ち、サイズが同じときのみ使い回す (use_count()の扱いはprepareWriteを参照)
+    if (buffer.use_count() != 1 || width != src.width || height != src.height)
+        create(src.width, src.height);
+
+    memcpy(image, src.image, stride * height);
+}
+
+/**
+ * @fn 共有している画素データを複製し、この画像専用にする
+ */
+void GrayImage::detach() {
+    //! 複製先
+    PixelBufferPtr newBuffer = std::make_shared<PixelBuffer>(stride * height);
+    memcpy(newBuffer->getData(), image, stride * height);
+
+    buffer = newBuffer;
+    image = buffer->getData();
+}
+
+/**
+ * @fn width getter
+ * @return width
+ */
+int GrayImage::getWidth() {
+    return width;
+}
+
+/**
+ * @fn height getter
+ * @return height
+ */
+int GrayImage::getHeight() {
+    return height;
+}
+
+/**
+ * @fn stride getter
+ * @return 1行あたりのバイト数
+ */
+int GrayImage::getStride() {
+    return stride;
+}
+
+/**
+ * @fn 指定された画素の値を取得
+ * @param row 行
+ * @param col 列
+ * @return 画素値
+ */
+int GrayImage::getValue(int row, int col) {
+    // 範囲外かどうかを確認
+    if (row < 0 || row >= height || col < 0 || col >= width) {
+        cout << "Error: getValue(): 範囲外" << endl;
+        return 0;
+    }
+
+    return image[row * stride + col];
+}
+
+/**
+ * @fn 指定された画素に値を設定
+ * @param row 行
+ * @param col 列
+ * @param value 画素値
+ */
+void GrayImage::setValue(int row, int col, int value) {
+    // 範囲外かどうかを確認
+    if (row < 0 || row >= height || col < 0 || col >= width) {
+        cout << "Error: setValue(): 範囲外" << endl;
+        return;
+    }
+
+    // 共有中であれば複製してから書き込む
+    prepareWrite();
+
+    image[row * stride + col] = value;
+}
+
+/**
+ * @fn 指定された行の先頭を取得
+ * @details 共有中の画素データは、ここで複製してから返す (以降に共有した場合は取得し直すこと)
+ * @param row 行
+ * @return 行の先頭のポインタ (width個の画素が連続して並ぶ)
+ */
+uint8_t *GrayImage::getRow(int row) {
+    prepareWrite();
+    return image + row * stride;
+}
+
+/**
+ * @fn 指定された行の先頭を読み込み用に取得
+ * @details 共有中の画素データも複製せずにそのまま返す
+ * @param row 行
+ * @return 行の先頭のポインタ
+ */
+const uint8_t *GrayImage::getConstRow(int row) {
+    return image + row * stride;
+}
@@ -0,0 +1,429 @@
+#include "histogram.hpp"
+#include "parallel.hpp"
+#include "pixel_convert.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @fn 文字列をファイルへ一度に書き出す
+ * @param filename ファイルの名前
+ * @param text 書き出す内容
+ * @return 書き出せたかどうか
+ */
+static bool writeText(string filename, const string &text) {
+    FILE *out = fopen(filename.c_str(), "wb");
+
+    if (out == NULL) {
+        cout << "Error: 書き出し先のファイルを開けません。" << endl;
+        return false;
+    }
+
+    size_t written = fwrite(text.data(), sizeof(char), text.size(), out);
+    fclose(out);
+
+    return written == text.size();
+}
+
+/**
+ * @fn カラー画像の一部の画素からグレイスケールのヒストグラムを推定する
+ * @details 全画素を変換・集計する代わりに、乱数で選んだ標本だけを読んでヒストグラムを作る。
+ *          判別分析法のしきい値は度数の比のみで決まるため、得られた度数をそのまま渡せる。
+ *          標本は重複を許して一様に選ぶため、正規化した累積分布の全画素との差が errorBound を超える確率は5%以下となる。
+ *          画素を選ぶときはDKW不等式 sqrt(ln(2 / 0.05) / (2 * 画素数)) を用いる。
+ *          行を選ぶときは行ごとの累積分布の平均とみなし、Hoeffding不等式を255個の階調について合わせた
+ *          sqrt(ln(2 * 255 / 0.05) / (2 * 行数)) を用いる (同じ行の画素は似ているため、画素数ではなく行数で決まる)。
+ *          実際の差はcompareHistogramsで確かめられる。選んだ位置を並べ替えてから、分けて並列に処理する
+ * @param src カラー画像
+ * @param count ヒストグラムの格納先 [0 256) (0で初期化してから集計する)
+ * @param step 標本の間隔 (1以下のときは全画素)
+ * @param mode 標本の取り方
+ * @param seed 標本を選ぶ乱数のシード
+ * @return 標本の画素数と誤差の上限
+ */
+HistogramSample sampleHistogram(BitmapManager &src, int *count, int step, SampleMode mode, unsigned seed) {
+    if (step < 1)
+        step = 1;
+    fill(count, count + 256, 0);
+
+    //! 元画像の先頭と1行あたりのバイト数 (スレッド内でgetRowを呼ばないよう先に取得)
+    const uint8_t *srcData = src.getConstRow(0);
+    int srcStride = src.getStride();
+    int width = src.getWidth();
+    int height = src.getHeight();
+
+    // 全画素のときは標本を選ばず、すべての行をそのまま集計する
+    if (step == 1)
+        mode = SAMPLE_ROWS;
+
+    //! 標本の位置 (行、または 行 * width + 列)
+    vector<long long> picks;
+    if (width > 0 && height > 0) {
+        if (step == 1) {
+            picks.resize(height);
+            for (int row = 0; row < height; row++)
+                picks[row] = row;
+        } else {
+            //! 選ぶ数と、選ぶ範囲
+            long long number = mode == SAMPLE_PIXELS
+                                   ? (long long)((width + step - 1) / step) * ((height + step - 1) / step)
+                                   : (height + step - 1) / step;
+            long long range = mode == SAMPLE_PIXELS ? (long long)width * height : height;
+
+            mt19937 engine(seed);
+            uniform_int_distribution<long long> distribution(0, range - 1);
+            picks.resize(number);
+            for (long long i = 0; i < number; i++)
+                picks[i] = distribution(engine);
+
+            // メモリ上の順に読むよう並べ替える (度数は変わらない)
+            sort(picks.begin(), picks.end());
+        }
+    }
+
+    HistogramSample sample;
+    sample.samples = mode == SAMPLE_PIXELS ? (long long)picks.size() : (long long)picks.size() * width;
+    if (sample.samples == 0) {
+        sample.errorBound = 1.0;
+        return sample;
+    }
+    if (step == 1)
+        sample.errorBound = 0.0;
+    else if (mode == SAMPLE_PIXELS)
+        sample.errorBound = sqrt(log(2.0 / 0.05) / (2.0 * picks.size()));
+    else
+        sample.errorBound = sqrt(log(2.0 * 255 / 0.05) / (2.0 * picks.size()));
+
+    //! スレッドごとのヒストグラム
+    vector<int> counts((size_t)getThreadCount() * HISTOGRAM_STRIDE, 0);
+
+    parallelFor(0, (int)picks.size(), [&](int first, int last, int index) {
+        //! このスレッドのヒストグラム
+        int *local = &counts[(size_t)index * HISTOGRAM_STRIDE];
+        //! 1行分のグレイスケール (SAMPLE_ROWS)
+        vector<uint8_t> gray(mode == SAMPLE_ROWS ? width : 0);
+
+        for (int i = first; i < last; i++) {
+            if (mode == SAMPLE_ROWS) {
+                convertBgrToGray(srcData + (size_t)picks[i] * srcStride, gray.data(), width);
+                for (int col = 0; col < width; col++)
+                    local[gray[col]]++;
+            } else {
+                const uint8_t *pixel = srcData + (size_t)(picks[i] / width) * srcStride + 3 * (size_t)(picks[i] % width);
+                local[(GRAY_WEIGHT_R * pixel[2] + GRAY_WEIGHT_G * pixel[1]
+                       + GRAY_WEIGHT_B * pixel[0] + GRAY_ROUND) >> 15]++;
+            }
+        }
+    });
+
+    for (size_t offset = 0; offset < counts.size(); offset += HISTOGRAM_STRIDE) {
+        for (int value = 0; value < 256; value++)
+            count[value] += counts[offset + value];
+    }
+
+    return sample;
+}
+
+/**
+ * @fn 2つのヒストグラムの差を求める
+ * @details それぞれを画素数で正規化した累積分布の差の絶対値の最大値 (コルモゴロフ-スミルノフ距離)
+ * @param full 全画素のヒストグラム [0 256)
+ * @param sampled 標本のヒストグラム [0 256)
+ * @return 差 (0〜1)
+ */
+double compareHistograms(const int *full, const int *sampled) {
+    long long fullTotal = 0, sampledTotal = 0;
+    for (int i = 0; i < 256; i++) {
+        fullTotal += full[i];
+        sampledTotal += sampled[i];
+    }
+    if (fullTotal == 0 || sampledTotal == 0)
+        return fullTotal == sampledTotal ? 0.0 : 1.0;
+
+    double distance = 0.0;
+    long long fullCum = 0, sampledCum = 0;
+    for (int i = 0; i < 256; i++) {
+        fullCum += full[i];
+        sampledCum += sampled[i];
+        double diff = fabs((double)fullCum / fullTotal - (double)sampledCum / sampledTotal);
+        if (distance < diff)
+            distance = diff;
+    }
+
+    return distance;
+}
+
+/**
+ * @fn ヒストグラムから累積度数・合計・エントロピーを求める
+ * @param count ヒストグラム [0 256)
+ */
+HistogramStats::HistogramStats(const int *count) {
+    long long total = 0;
+    sum = squareSum = 0;
+
+    for (int i = 0; i < 256; i++) {
+        total += count[i];
+        sum += (long long)i * count[i];
+        squareSum += (long long)i * i * count[i];
+        cumCount[i] = total;
+    }
+
+    entropy = 0.0;
+    for (int i = 0; i < 256; i++) {
+        if (count[i] > 0) {
+            double p = (double)count[i] / total;
+            entropy -= p * log2(p);
+        }
+    }
+}
+
+/**
+ * @fn 画素数を取得
+ */
+long long HistogramStats::getTotal() {
+    return cumCount[255];
+}
+
+/**
+ * @fn 最小の画素値を取得
+ * @return 度数が0でない最小の画素値 (画素がなければ0)
+ */
+int HistogramStats::getMin() {
+    for (int i = 0; i < 256; i++) {
+        if (cumCount[i] > 0)
+            return i;
+    }
+    return 0;
+}
+
+/**
+ * @fn 最大の画素値を取得
+ * @return 度数が0でない最大の画素値 (画素がなければ0)
+ */
+int HistogramStats::getMax() {
+    for (int i = 255; i > 0; i--) {
+        if (cumCount[i - 1] < cumCount[i])
+            return i;
+    }
+    return 0;
+}
+
+/**
+ * @fn 平均を取得 (画素がなければ0)
+ */
+double HistogramStats::getMean() {
+    return getTotal() > 0 ? (double)sum / getTotal() : 0.0;
+}
+
+/**
+ * @fn 分散を取得 (画素がなければ0)
+ * @details 2乗の平均 - 平均の2乗
+ */
+double HistogramStats::getVariance() {
+    if (getTotal() == 0)
+        return 0.0;
+
+    double mean = getMean();
+    double variance = (double)squareSum / getTotal() - mean * mean;
+    return variance > 0.0 ? variance : 0.0;
+}
+
+/**
+ * @fn 標準偏差を取得
+ */
+double HistogramStats::getStdDev() {
+    return sqrt(getVariance());
+}
+
+/**
+ * @fn パーセント点を取得
+ * @details 累積度数が 画素数 * percent / 100 (切り上げ、最低1) 以上となる最小の画素値 (nearest-rank)。
+ *          累積度数は単調増加のため二分探索で求める
+ * @param percent 0〜100 (範囲外は切り詰める)
+ * @return 画素値 (画素がなければ0)
+ */
+int HistogramStats::getPercentile(double percent) {
+    if (getTotal() == 0)
+        return 0;
+    if (percent < 0.0)
+        percent = 0.0;
+    if (percent > 100.0)
+        percent = 100.0;
+
+    //! 目標の順位
+    long long rank = (long long)ceil(getTotal() * percent / 100.0);
+    if (rank < 1)
+        rank = 1;
+
+    int first = 0, last = 255;
+    while (first < last) {
+        int middle = (first + last) / 2;
+        if (cumCount[middle] >= rank)
+            last = middle;
+        else
+            first = middle + 1;
+    }
+
+    return first;
+}
+
+/**
+ * @fn 中央値を取得
+ */
+int HistogramStats::getMedian() {
+    return getPercentile(50.0);
+}
+
+/**
+ * @fn エントロピーを取得
+ * @return -Σ p log2 p [bit] (一様な画像は0、全階調が同じ度数なら8)
+ */
+double HistogramStats::getEntropy() {
+    return entropy;
+}
+
+/**
+ * @fn ヒストグラムをCSVで書き出す
+ * @details 1行目は見出し (value,count)、以降は画素値ごとに1行
+ * @param filename ファイルの名前
+ * @param count ヒストグラム [0 256)
+ * @return 書き出せたかどうか
+ */
+bool writeHistogramCsv(string filename, const int *count) {
+    string text = "value,count\n";
+
+    for (int i = 0; i < 256; i++)
+        text += to_string(i) + "," + to_string(count[i]) + "\n";
+
+    return writeText(filename, text);
+}
+
+/**
+ * @fn ヒストグラムをJSONで書き出す
+ * @details {"total": 画素数, "count": [画素値0の度数, ..., 画素値255の度数]}
+ * @param filename ファイルの名前
+ * @param count ヒストグラム [0 256)
+ * @return 書き出せたかどうか
+ */
+bool writeHistogramJson(string filename, const int *count) {
+    long long total = 0;
+    for (int i = 0; i < 256; i++)
+        total += count[i];
+
+    string text = "{\"total\": " + to_string(total) + ", \"count\": [";
+
+    for (int i = 0; i < 256; i++) {
+        if (i > 0)
+            text += ", ";
+        text += to_string(count[i]);
+    }
+    text += "]}\n";
+
+    return writeText(filename, text);
+}
+
+/**
+ * @fn ヒストグラムの棒グラフを描画する
+ * @details 白地に黒で、1階調を幅2画素の棒として描く。縦軸は最大の度数が図の高さの9割になるよう合わせ、
+ *          左端と下端に軸の線を引く
+ * @param count ヒストグラム [0 256)
+ * @param plot 出力先 (HISTOGRAM_PLOT_WIDTH x HISTOGRAM_PLOT_HEIGHTで作り直される)
+ */
+void renderHistogram(const int *count, GrayImage &plot) {
+    plot.create(HISTOGRAM_PLOT_WIDTH, HISTOGRAM_PLOT_HEIGHT);
+
+    //! 最大の度数
+    int max = 1;
+    for (int i = 0; i < 256; i++) {
+        if (max < count[i])
+            max = count[i];
+    }
+
+    //! 1階調あたりの幅
+    int barWidth = HISTOGRAM_PLOT_WIDTH / 256;
+    //! 棒の高さの上限
+    int barMax = HISTOGRAM_PLOT_HEIGHT * 9 / 10;
+
+    // 各行について、その高さに届く棒の位置を黒、それ以外を白にする (行0が下端)
+    for (int row = 0; row < HISTOGRAM_PLOT_HEIGHT; row++) {
+        uint8_t *line = plot.getRow(row);
+        memset(line, 255, HISTOGRAM_PLOT_WIDTH);
+
+        for (int i = 0; i < 256; i++) {
+            //! 棒の高さ
+            int barHeight = (int)((long long)count[i] * barMax / max);
+
+            if (row < barHeight || (count[i] > 0 && row == 0))
+                memset(line + i * barWidth, 0, barWidth);
+        }
+
+        // 縦軸
+        line[0] = 0;
+    }
+
+    // 横軸
+    memset(plot.getRow(0), 0, HISTOGRAM_PLOT_WIDTH);
+}
+
+/**
+ * @fn ヒストグラムの棒グラフを1bitのBMPで書き出す
+ * @param filename ファイルの名前
+ * @param count ヒストグラム [0 256)
+ * @return 書き出せたかどうか
+ */
+bool writeHistogramPlot(string filename, const int *count) {
+    GrayImage plot;
+    renderHistogram(count, plot);
+
+    EncodedBitmap bmp;
+    plot.encode(bmp, WRITE_1BIT);
+
+    return writeEncodedBitmap(filename, bmp);
+}
+
+/**
+ * @fn gnuplotを用いてヒストグラムのPNGを書き出す
+ * @details gnuplotを起動できない環境ではエラーを表示してfalseを返す
+ * @param filename ファイルの名前
+ * @param count ヒストグラム [0 256)
+ * @return gnuplotが正常に終了したかどうか
+ */
+bool writeHistogramGnuplot(string filename, const int *count) {
+    //! ヒストグラムの最大値
+    int max = 0;
+    for (int i = 0; i < 256; i++) {
+        if (max < count[i])
+            max = count[i];
+    }
+
+    // gnuplot 起動・設定
+    FILE *gp = popen("gnuplot -persist", "w");  // パイプを開き、gnuplotの立ち上げ
+
+    if (gp == NULL) {
+        cout << "Error: gnuplotを起動できません。" << endl;
+        return false;
+    }
+
+    fprintf(gp, "set terminal png\n");
+    fprintf(gp, "set out \"%s\"\n", filename.c_str());
+    fprintf(gp, "set xrange [0:255]\n");  // 範囲の指定 x[0 255]
+    fprintf(gp, "set yrange [0:%d]\n", max + 500);  // 範囲の指定 y[0 ヒストグラムの最大値+500]
+    fprintf(gp, "set xlabel \"Pixel Values\"\n");  // ラベル表示
+    fprintf(gp, "set ylabel \"Frequency\"\n");
+
+    // プロット
+    fprintf(gp, "plot '-' with lines linetype 1\n");
+    for (int i = 0; i < 256; ++i) {
+        fprintf(gp, "%d\t%d\n", i, count[i]);
+    }
+    fprintf(gp, "e\n");
+
+    // gnuplot 終了処理
+    fprintf(gp, "exit\n"); // gnuplotの終了
+    fflush(gp);
+
+    return pclose(gp) == 0; // パイプを閉じる
+}
@@ -0,0 +1,66 @@
+#include "integral_image.hpp"
+#include "parallel.hpp"
+
+using namespace std;
+
+/**
+ * @fn 積分画像を作成する
+ * @details 1回目は行ごとに横方向の累積和を、2回目は列の範囲ごとに縦方向の累積和を求める。
+ *          どちらも互いに独立した範囲を複数のスレッドで処理する
+ * @param img 元画像
+ */
+void IntegralImage::build(GrayImage &img) {
+    width = img.getWidth();
+    height = img.getHeight();
+
+    //! 1行あたりの要素数
+    size_t stride = width + 1;
+    sum.assign(stride * (height + 1), 0);
+    squareSum.assign(stride * (height + 1), 0);
+
+    // 横方向の累積和
+    parallelFor(0, height, [&](int first, int last, int) {
+        for (int row = first; row < last; row++) {
+            //! 元画像の行
+            const uint8_t *src = img.getConstRow(row);
+            uint32_t *sumRow = &sum[(row + 1) * stride];
+            uint64_t *squareRow = &squareSum[(row + 1) * stride];
+
+            for (int col = 0; col < width; col++) {
+                sumRow[col + 1] = sumRow[col] + src[col];
+                squareRow[col + 1] = squareRow[col] + (uint32_t)src[col] * src[col];
+            }
+        }
+    });
+
+    // 縦方向の累積和 (列を分けて、各スレッドが上から順に足す)
+    parallelFor(1, width + 1, [&](int first, int last, int) {
+        for (int row = 1; row < height; row++) {
+            const uint32_t *sumPrev = &sum[row * stride];
+            uint32_t *sumRow = &sum[(row + 1) * stride];
+            const uint64_t *squarePrev = &squareSum[row * stride];
+            uint64_t *squareRow = &squareSum[(row + 1) * stride];
+
+            for (int col = first; col < last; col++) {
+                sumRow[col] += sumPrev[col];
+                squareRow[col] += squarePrev[col];
+            }
+        }
+    });
+}
+
+/**
+ * @fn width getter
+ * @return width
+ */
+int IntegralImage::getWidth() {
+    return width;
+}
+
+/**
+ * @fn height getter
+ * @return height
+ */
+int IntegralImage::getHeight() {
+    return height;
+}
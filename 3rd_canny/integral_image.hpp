@@ -0,0 +1,64 @@
+#ifndef INTEGRAL_IMAGE_HPP
+#define INTEGRAL_IMAGE_HPP
+
+#include <vector>
+#include "gray_image.hpp"
+
+/**
+ * @brief 画素値と画素値の2乗の積分画像 (先頭の行・列からの累積和)
+ * @details 一度作れば、任意の大きさの矩形の平均・分散を4点の参照でO(1)に求められる。
+ *          画素値の累積和は32bitで持ち、桁あふれは2^32を法とした差で打ち消す
+ *          (矩形内の合計が2^32未満、つまり約1600万画素以下の矩形であれば正しい)。
+ *          2乗の累積和は64bitで持つ
+ */
+class IntegralImage {
+    // フィールド定義
+    std::vector<uint32_t> sum;  // (height + 1) x (width + 1)。先頭の行・列は0
+    std::vector<uint64_t> squareSum;
+    int width;
+    int height;
+
+public:
+    // コンストラクタ
+    IntegralImage() {
+        width = height = 0;
+    }
+
+    // メソッド定義
+    void build(GrayImage &img);  // 積分画像を作成 (行・列ごとに並列)
+    int getWidth();
+    int getHeight();
+
+    /**
+     * @fn 中心 (row, col)、半径radiusの正方形 (画像の外は除く) の平均と分散を求める
+     * @param row 行
+     * @param col 列
+     * @param radius 半径 (一辺は 2 * radius + 1)
+     * @param mean 平均の格納先
+     * @param variance 分散の格納先
+     */
+    void getWindowStats(int row, int col, int radius, double &mean, double &variance) {
+        //! 矩形の範囲 [top, bottom) x [left, right)
+        int top = row - radius < 0 ? 0 : row - radius;
+        int bottom = row + radius + 1 > height ? height : row + radius + 1;
+        int left = col - radius < 0 ? 0 : col - radius;
+        int right = col + radius + 1 > width ? width : col + radius + 1;
+
+        //! 1行あたりの要素数
+        size_t stride = width + 1;
+        //! 矩形の画素数
+        double area = (double)(bottom - top) * (right - left);
+
+        uint32_t s = sum[bottom * stride + right] - sum[top * stride + right]
+                     - sum[bottom * stride + left] + sum[top * stride + left];
+        uint64_t sq = squareSum[bottom * stride + right] - squareSum[top * stride + right]
+                      - squareSum[bottom * stride + left] + squareSum[top * stride + left];
+
+        mean = s / area;
+        variance = sq / area - mean * mean;
+        if (variance < 0.0)
+            variance = 0.0;
+    }
+};
+
+#endif // INTEGRAL_IMAGE_HPP
@@ -0,0 +1,44 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <thread>
+#include <vector>
+
+//! @def スレッドごとのヒストグラムの間隔 (256個 + キャッシュライン1本分の詰め物。別のスレッドの度数と同じキャッシュラインに載らない)
+#define HISTOGRAM_STRIDE (256 + 64 / sizeof(int))
+
+int getThreadCount();  // 並列処理に用いるスレッド数を取得
+void setThreadCount(int count);  // 並列処理に用いるスレッド数を設定 (0以下でCPUのコア数)
+
+/**
+ * @fn [begin, end) を連続した区間に分け、複数のスレッドで処理する
+ * @details 区間の数は min(getThreadCount(), end - begin)。最初の区間は呼び出したスレッドで処理し、
+ *          すべての区間が終わるまで戻らない。区間の分け方は件数とスレッド数のみで決まる
+ * @param begin 開始位置
+ * @param end 終了位置 (含まない)
+ * @param func 処理 func(区間の開始, 区間の終了, 区間の番号)
+ */
+template <typename Func>
+void parallelFor(int begin, int end, const Func &func) {
+    //! 全体の件数
+    int total = end - begin;
+    if (total <= 0)
+        return;
+
+    //! 区間の数
+    int chunks = getThreadCount() < total ? getThreadCount() : total;
+    std::vector<std::thread> workers;
+
+    for (int i = 1; i < chunks; i++) {
+        workers.push_back(std::thread([&func, begin, total, chunks, i] {
+            func(begin + (int)((long)total * i / chunks), begin + (int)((long)total * (i + 1) / chunks), i);
+        }));
+    }
+
+    func(begin, begin + total / chunks, 0);
+
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+#endif // PARALLEL_HPP
@@ -1,5 +1,10 @@
 #define _USE_MATH_DEFINES
 #include "bitmap_manager.hpp"
+#include "gray_image.hpp"
+#include "threshold.hpp"
+#include "contrast.hpp"
+#include "histogram.hpp"
+#include "color_mask.hpp"
 #include <algorithm>
 
 using namespace std;
@@ -59,97 +64,30 @@ struct Rectangle {
 
 /**
  * @fn カラー画像をグレイスケール画像へ変換
+ * @details 0.3R + 0.59G + 0.11B を固定小数点で求める。変換とヒストグラムの集計は行を分けて並列に行う
  * @param bmp ビットマップマネージャー
+ * @param gray 出力先のグレイスケール画像
  * @count ヒストグラム用の配列 [0 256)
  */
-void color2Grayscale(BitmapManager *bmp, int *count) {
-    //! 各色に乗ずる係数
-    const float c_r = 0.3;
-    const float c_g = 0.59;
-    const float c_b = 0.11;
-
-    //! 各画素の色を保存する変数
-    Color color;
-    //! カラー画素から生成したグレイスケールの値
-    int grayValue;
-
-    for (int row = 0; row < bmp->getHeight(); row++){
-        for (int col = 0; col < bmp->getWidth(); col++){
-            // カラー取得
-            color = bmp->getColor(row, col);
-
-            // 変換式によってグレースケールへ変換
-            grayValue = (int)(c_r * color.r + c_g * color.g + c_b * color.b);
-
-            // 求めたグレースケール値をセット
-            bmp->setColor(row, col, grayValue, grayValue, grayValue);
-
-            // ヒストグラム用にグレースケール値をカウント
-            count[grayValue]++;
-        }
-    }
+void color2Grayscale(BitmapManager *bmp, GrayImage *gray, int *count) {
+    gray->fromColor(*bmp, count);
 }
 
 /**
  * @fn 判別分析法を用いて画像を2値化
+ * @details しきい値は累積ヒストグラムからO(256)で求める (OtsuThreshold)
  */
-void applyBinarization(BitmapManager *bmp, int *hist) {
+void applyBinarization(GrayImage *img, int *hist) {
 
     // 判別分析法
+    OtsuThreshold otsu(hist);
     //! しきい値
-    int threshold = 0;
-    //! pixelNum1 * pixelNum2 * (ave1 - ave2)^2 の最大値
-    double max = 0.0;
-
-    for (int i = 0; i < 256; ++i){
-        int pixelNum1 = 0;  //! クラス1の画素数
-        int pixelNum2 = 0;  //! クラス2の画素数
-        long sum1 = 0;  //! クラス1の平均を出すための合計値
-        long sum2 = 0;  //! クラス2の平均を出すための合計値
-        double ave1 = 0.0;  //! クラス1の平均
-        double ave2 = 0.0;  //! クラス2の平均
-
-        // iまで クラス1へ格納
-        for (int j = 0; j <= i; ++j){
-            pixelNum1 += hist[j];
-            sum1 += j * hist[j];
-        }
-
-        // i以降 クラス2へ格納
-        for (int j = i + 1; j < 256; ++j){
-            pixelNum2 += hist[j];
-            sum2 += j * hist[j];
-        }
-
-        // 平均導出
-        if (pixelNum1)
-            ave1 = (double)sum1 / pixelNum1;
-
-        if (pixelNum2)
-            ave2 = (double)sum2 / pixelNum2;
-
-        // 分散導出
-        double tmp = ((double)pixelNum1 * pixelNum2 * (ave1 - ave2) * (ave1 - ave2));
-
-        // 最大値更新
-        if (tmp > max){
-            max = tmp;
-            threshold = i;
-        }
-    }
+    int threshold = otsu.getThreshold();
 
     cout << "threshold: " << threshold << endl;
 
-    /* tの値を使って2値化 */
-    for (int row = 0; row < bmp->getHeight(); row++){
-        for (int col = 0; col < bmp->getWidth(); col++){
-            // しきい値を下回れば0、上回れば255で書き込み
-            if (bmp->getColor(row, col).r < threshold)
-                bmp->setColor(row, col, 0, 0, 0);
-            else
-                bmp->setColor(row, col, 255, 255, 255);
-        }
-    }
+    /* tの値を使って2値化 (しきい値を下回れば0、上回れば255) */
+    applyThresholds(*img, vector<int>(1, threshold));
 }
 
 /**
@@ -158,9 +96,9 @@ void applyBinarization(BitmapManager *bmp, int *hist) {
  * @param lut ラベル番号処理用のルックアップテーブル
  * @param label ラベルをデータとした二次元配列
  */
-void applyClassification(BitmapManager *img, vector<int> lut, Label label) {
+void applyClassification(GrayImage *img, vector<int> lut, Label label) {
 
-    int candidate = 0, tempColor = 0;
+    int candidate = 0;
     bool existNonZero = false;
     vector<int> surround;
 
@@ -177,7 +115,7 @@ void applyClassification(BitmapManager *img, vector<int> lut, Label label) {
         for (int col = 1; col < img->getWidth()-1; col++){
 
             // 注目画素が白のとき
-            if (img->getColor(row, col).r == 255){
+            if (img->getValue(row, col) == 255){
                 surround.clear();
                 // 左下、下、右下、左の画素を取得
                 surround.push_back(label.getData(row-1, col-1));
@@ -317,8 +255,50 @@ void displayClassification(BitmapManager *img, Label label) {
 
 int main(int argc, char *argv[]) {
 
-    if (argc != 2){
-        cerr << "Usage ./prog filename(without .bmp)" << endl;
+    // --probe: ヘッダーのみを読み込み、画像情報を一覧表示
+    if (argc >= 2 && string(argv[1]) == "--probe")
+        return probeFiles(argc - 2, argv + 2);
+
+    // ファイル名より前に指定するオプション
+    // --equalize / --clahe: 2値化の前にコントラストを補正
+    // --sample step: 縦横step画素ごとの標本からヒストグラムを推定 (全画素の集計を省く)
+    ContrastMode contrast = CONTRAST_NONE;
+    int sampleStep = 0;
+    while (argc >= 2) {
+        if (parseContrastOption(argv[1], contrast)) {
+            argc--;
+            argv++;
+        } else if (string(argv[1]) == "--sample" && argc >= 3) {
+            sampleStep = atoi(argv[2]);
+            argc -= 2;
+            argv += 2;
+        } else {
+            break;
+        }
+    }
+
+    if (argc < 2 || argc > 4){
+        cerr << "Usage ./prog [--equalize|--clahe] [--sample step] filename(without .bmp) [otsu|niblack|sauvola|bradley [window]|hsv|ycbcr range]" << endl;
+        cerr << "      ./prog --probe file.bmp..." << endl;
+        return -1;
+    }
+
+    //! 2値化の方法 (既定は判別分析法。それ以外は窓の大きさ window の適応的2値化)
+    string method = argc >= 3 ? argv[2] : "otsu";
+    int window = argc >= 4 ? atoi(argv[3]) : ADAPTIVE_WINDOW;
+    AdaptiveMethod adaptive;
+    //! 色で切り出すときの色空間と範囲 (methodが hsv / ycbcr のとき、windowの位置に範囲を指定)
+    ColorSpace space;
+    ColorRange range;
+    bool colorMask = parseColorSpace(method, space);
+
+    if (colorMask && (argc < 4 || !parseColorRange(argv[3], range))) {
+        cerr << "Error: specify a color range such as 0,100,50:10,255,255." << endl;
+        return -1;
+    }
+
+    if (method != "otsu" && !colorMask && !parseAdaptiveMethod(method, adaptive)) {
+        cerr << "Error: unknown method " << method << "." << endl;
         return -1;
     }
 
@@ -330,13 +310,14 @@ int main(int argc, char *argv[]) {
 
 
     // Bitmap
-    BitmapManager src, gray, binarization, imgClassification;
+    BitmapManager src;
+    GrayImage gray, binarization, imgClassification;
 
     //! for color2Grayscale
     int count[256] = {0};
 
     // 画像読み込み
-    src.loadData(src_filename);
+    src.loadData(src_filename, LOAD_MMAP);
     src.displayHeader();
 
     // LUT for applyClassification
@@ -344,18 +325,31 @@ int main(int argc, char *argv[]) {
     Label label;
     label.setSize(src.getWidth(), src.getHeight());
 
-    // グレースケール化
-    gray.copy(src);
-    color2Grayscale(&gray, count);
+    // グレースケール化 (標本から推定したときは、変換時にヒストグラムを集計しない)
+    if (sampleStep > 1) {
+        HistogramSample sample = sampleHistogram(src, count, sampleStep);
+        cout << "sampled: " << sample.samples << " pixels, cdf error <= " << sample.errorBound << " (95%)" << endl;
+        color2Grayscale(&src, &gray, nullptr);
+    } else {
+        color2Grayscale(&src, &gray, count);
+    }
     gray.writeData(gray_filename);
 
     // 処理
-    // 1. 2値化
-    binarization.copy(gray);
-    applyBinarization(&binarization, count);
-    binarization.writeData(binarization_filename);
+    // 1. 2値化 (照明むらがある画像では適応的2値化、色で切り出す場合は色の範囲を指定する)
+    if (colorMask) {
+        applyColorMask(src, binarization, space, range);
+    } else {
+        binarization.copy(gray, true);
+        applyContrast(binarization, contrast, count);
+        if (method == "otsu")
+            applyBinarization(&binarization, count);
+        else
+            applyAdaptiveThreshold(binarization, adaptive, window);
+    }
+    binarization.writeData(binarization_filename, WRITE_1BIT);
     // 2. ラベリング
-    imgClassification.copy(binarization);
+    imgClassification.copy(binarization, true);
     applyClassification(&imgClassification, lut, label);
     // 3. ラベリングの枠をカラー画像に表示
     displayClassification(&src, label);
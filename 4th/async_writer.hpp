@@ -0,0 +1,58 @@
+#ifndef ASYNC_WRITER_HPP
+#define ASYNC_WRITER_HPP
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "bitmap_manager.hpp"
+#include "gray_image.hpp"
+
+/**
+ * @brief 書き出し待ちの画像
+ */
+typedef struct WriteJob {
+    std::string filename;
+    EncodedBitmap bmp;
+} WriteJob;
+
+/**
+ * @brief 画像の書き出しを別スレッドで行うクラス
+ * @details write()は画素データを共有してキューへ積むだけなので、呼び出し側はすぐに次の処理へ進める。
+ *          キューが上限に達した場合は空きができるまでwrite()が待つ (メモリを使い過ぎないため)。
+ *          書き出し後にfsyncは行わない
+ */
+class AsyncWriter {
+    // フィールド定義
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable queued;  // キューに積まれた、または終了要求
+    std::condition_variable done;  // キューから取り出して書き出し終えた
+    std::deque<WriteJob> jobs;
+    size_t maxJobs;  // キューの上限
+    int writing;  // 書き出し中の数 (0 または 1)
+    int failed;  // 書き出しに失敗した数
+    bool stopping;
+
+public:
+    // コンストラクタ (書き出し用のスレッドを起動)
+    explicit AsyncWriter(size_t maxJobs = 8);
+
+    // デストラクタ (キューに残っている画像をすべて書き出してから終了)
+    ~AsyncWriter();
+
+    AsyncWriter(const AsyncWriter &) = delete;
+    AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+    // メソッド定義
+    void write(std::string filename, BitmapManager &img, WriteFormat format = WRITE_DEFAULT);  // 既定は24bit形式
+    void write(std::string filename, GrayImage &img, WriteFormat format = WRITE_DEFAULT);  // 既定は8bitパレット形式
+    void flush();  // キューが空になり、書き出しが終わるまで待つ
+    int getFailedCount();  // 書き出しに失敗した数を取得
+
+private:
+    void enqueue(WriteJob &job);
+    void run();
+};
+
+#endif // ASYNC_WRITER_HPP
@@ -0,0 +1,282 @@
+#include "contrast.hpp"
+#include "parallel.hpp"
+#include "point_op.hpp"
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @fn コマンドライン引数から補正の方法を得る
+ * @param option 引数 ("--equalize", "--clahe")
+ * @param mode 格納先
+ * @return 該当する方法があればtrue
+ */
+bool parseContrastOption(string option, ContrastMode &mode) {
+    if (option == "--equalize")
+        mode = CONTRAST_EQUALIZE;
+    else if (option == "--clahe")
+        mode = CONTRAST_CLAHE;
+    else
+        return false;
+
+    return true;
+}
+
+/**
+ * @fn ヒストグラムから平坦化の変換表を作る
+ * @details 累積度数 cdf を用いて (cdf[v] - cdf_min) * 255 / (total - cdf_min) を四捨五入する
+ *          (cdf_min は最も暗い画素値の累積度数)。画素値が1種類しかないときは恒等変換とする
+ * @param hist ヒストグラム [0 256)
+ * @param table 変換表の格納先 [0 256)
+ */
+static void makeEqualizationTable(const int *hist, uint8_t *table) {
+    //! 累積度数
+    long long cdf[256];
+    long long total = 0;
+    for (int value = 0; value < 256; value++) {
+        total += hist[value];
+        cdf[value] = total;
+    }
+
+    //! 最も暗い画素値の累積度数
+    long long cdfMin = 0;
+    for (int value = 0; value < 256; value++) {
+        if (cdf[value] > 0) {
+            cdfMin = cdf[value];
+            break;
+        }
+    }
+
+    long long range = total - cdfMin;
+    for (int value = 0; value < 256; value++) {
+        if (range <= 0)
+            table[value] = value;
+        else if (cdf[value] <= cdfMin)
+            table[value] = 0;
+        else
+            table[value] = (uint8_t)(((cdf[value] - cdfMin) * 255 + range / 2) / range);
+    }
+}
+
+/**
+ * @fn 画像のヒストグラムを集計する
+ * @param img 対象画像
+ * @param hist 格納先 [0 256) (0で初期化してから集計する)
+ */
+static void countHistogram(GrayImage &img, int *hist) {
+    fill(hist, hist + 256, 0);
+
+    for (int row = 0; row < img.getHeight(); row++) {
+        const uint8_t *line = img.getConstRow(row);
+        for (int col = 0; col < img.getWidth(); col++)
+            hist[line[col]]++;
+    }
+}
+
+/**
+ * @fn ヒストグラム平坦化を適用する
+ * @details 変換表を1つ作り、全画素を一度だけ置き換える
+ * @param img 対象画像
+ * @param hist 画像のヒストグラム [0 256) (nullptrなら画像から集計する)
+ */
+void applyEqualization(GrayImage &img, const int *hist) {
+    if (img.getWidth() == 0 || img.getHeight() == 0)
+        return;
+
+    //! 集計したヒストグラム (histがないとき)
+    int counted[256];
+    if (hist == nullptr) {
+        countHistogram(img, counted);
+        hist = counted;
+    }
+
+    uint8_t table[256];
+    makeEqualizationTable(hist, table);
+    applyLookupTable(img, table);
+}
+
+/**
+ * @fn タイルのヒストグラムの度数を上限で切り、切った分を全階調へ均等に配る
+ * @param hist タイルのヒストグラム [0 256)
+ * @param limit 度数の上限
+ */
+static void clipHistogram(int *hist, int limit) {
+    //! 上限を超えた度数の合計
+    int excess = 0;
+    for (int value = 0; value < 256; value++) {
+        if (hist[value] > limit) {
+            excess += hist[value] - limit;
+            hist[value] = limit;
+        }
+    }
+
+    // 全階調へ同じ数ずつ配り、余りは間隔をあけて1ずつ配る
+    int share = excess / 256;
+    int rest = excess % 256;
+    for (int value = 0; value < 256; value++)
+        hist[value] += share;
+
+    if (rest > 0) {
+        int step = 256 / rest;
+        for (int value = 0; value < 256 && rest > 0; value += step, rest--)
+            hist[value]++;
+    }
+}
+
+/**
+ * @fn 双線形補間に用いるタイルと重みを1軸分求める
+ * @details タイルの中心の間にある位置は、手前のタイルiと次のタイルi+1を距離の比で補間する。
+ *          最初のタイルの中心より手前・最後のタイルの中心より先は、端のタイルの変換表をそのまま使う (重み0)
+ * @param edge タイルの境界 (タイル数 + 1個、最後は画像の大きさ)
+ * @param tile 位置ごとの手前のタイルの格納先
+ * @param weight 位置ごとの次のタイルの重みの格納先 [0 1)
+ */
+static void makeInterpolation(const vector<int> &edge, vector<int> &tile, vector<float> &weight) {
+    //! タイルの数
+    int tiles = (int)edge.size() - 1;
+    int size = edge[tiles];
+
+    tile.assign(size, 0);
+    weight.assign(size, 0.0f);
+
+    int t = 0;
+    for (int pos = 0; pos < size; pos++) {
+        //! タイルtと次のタイルの中心
+        float center = (edge[t] + edge[t + 1] - 1) * 0.5f;
+        while (t + 1 < tiles && pos >= (edge[t + 1] + edge[t + 2] - 1) * 0.5f) {
+            t++;
+            center = (edge[t] + edge[t + 1] - 1) * 0.5f;
+        }
+
+        tile[pos] = t;
+        if (t + 1 < tiles && pos > center) {
+            float next = (edge[t + 1] + edge[t + 2] - 1) * 0.5f;
+            weight[pos] = (pos - center) / (next - center);
+        }
+    }
+}
+
+/**
+ * @fn CLAHE (コントラスト制限付き適応的ヒストグラム平坦化) を適用する
+ * @details 画像を tiles x tiles のタイルに分け、タイルごとのヒストグラムと変換表を並列に求める。
+ *          度数は 1階調あたりの平均度数 * clipLimit で切り、ノイズの強調を抑える。
+ *          各画素は周囲4タイルの中心からの距離で4つの変換表の結果を双線形補間する (行を分けて並列に処理)
+ * @param img 対象画像
+ * @param tiles 縦横それぞれのタイルの数 (画像の幅・高さを超えるときは切り詰める)
+ * @param clipLimit 度数の上限の倍率 (1未満のときは1)
+ */
+void applyClahe(GrayImage &img, int tiles, double clipLimit) {
+    int width = img.getWidth();
+    int height = img.getHeight();
+    if (width == 0 || height == 0)
+        return;
+
+    //! 横・縦のタイルの数
+    int tilesX = tiles < 1 ? 1 : (tiles > width ? width : tiles);
+    int tilesY = tiles < 1 ? 1 : (tiles > height ? height : tiles);
+    if (clipLimit < 1.0)
+        clipLimit = 1.0;
+
+    //! タイルの境界 (タイルiは [edge[i], edge[i + 1]) )
+    vector<int> edgeX(tilesX + 1), edgeY(tilesY + 1);
+    for (int i = 0; i <= tilesX; i++)
+        edgeX[i] = (int)((long)width * i / tilesX);
+    for (int i = 0; i <= tilesY; i++)
+        edgeY[i] = (int)((long)height * i / tilesY);
+
+    //! 1行あたりのバイト数と読み込み用の先頭 (スレッド内でgetRowを呼ばないよう先に取得)
+    int stride = img.getStride();
+    const uint8_t *src = img.getConstRow(0);
+
+    //! タイルごとの変換表 [tilesX * tilesY][256]
+    vector<uint8_t> tables((size_t)tilesX * tilesY * 256);
+
+    parallelFor(0, tilesX * tilesY, [&](int first, int last, int) {
+        for (int tile = first; tile < last; tile++) {
+            int tx = tile % tilesX;
+            int ty = tile / tilesX;
+
+            int hist[256] = {0};
+            for (int row = edgeY[ty]; row < edgeY[ty + 1]; row++) {
+                const uint8_t *line = src + (size_t)row * stride;
+                for (int col = edgeX[tx]; col < edgeX[tx + 1]; col++)
+                    hist[line[col]]++;
+            }
+
+            //! タイルの画素数
+            int pixels = (edgeX[tx + 1] - edgeX[tx]) * (edgeY[ty + 1] - edgeY[ty]);
+            int limit = (int)(clipLimit * pixels / 256);
+            clipHistogram(hist, limit < 1 ? 1 : limit);
+
+            // 変換表 (切った後も度数の合計はpixelsのまま)
+            uint8_t *table = &tables[(size_t)tile * 256];
+            long long cdf = 0;
+            for (int value = 0; value < 256; value++) {
+                cdf += hist[value];
+                table[value] = (uint8_t)((cdf * 255 + pixels / 2) / pixels);
+            }
+        }
+    });
+
+    // 列・行ごとの補間に用いるタイルと重み
+    vector<int> leftTile, topTile;
+    vector<float> rightWeight, bottomWeight;
+    makeInterpolation(edgeX, leftTile, rightWeight);
+    makeInterpolation(edgeY, topTile, bottomWeight);
+
+    //! 出力先の先頭 (ここで画素データの共有を解く)
+    uint8_t *data = img.getRow(0);
+
+    parallelFor(0, height, [&](int first, int last, int) {
+        for (int row = first; row < last; row++) {
+            uint8_t *line = data + (size_t)row * stride;
+            //! 上側・下側のタイルの行の変換表
+            int top = topTile[row];
+            const uint8_t *upperTables = &tables[(size_t)top * tilesX * 256];
+            const uint8_t *lowerTables = &tables[(size_t)(top + 1 < tilesY ? top + 1 : top) * tilesX * 256];
+            float wy = bottomWeight[row];
+
+            for (int col = 0; col < width; col++) {
+                int value = line[col];
+                int left = leftTile[col] * 256 + value;
+                int right = (leftTile[col] + 1 < tilesX ? leftTile[col] + 1 : leftTile[col]) * 256 + value;
+                float wx = rightWeight[col];
+
+                float upper = upperTables[left] + (upperTables[right] - upperTables[left]) * wx;
+                float lower = lowerTables[left] + (lowerTables[right] - lowerTables[left]) * wx;
+                line[col] = (uint8_t)(upper + (lower - upper) * wy + 0.5f);
+            }
+        }
+    });
+}
+
+/**
+ * @fn 指定した方法でコントラストを補正する
+ * @details 2値化 (applyBinarization) や平滑化 (applyGaussianFilter5x5) の前に、同じ画像に対してその場で行う
+ * @param img 対象画像
+ * @param mode 補正の方法
+ * @param hist 画像のヒストグラム [0 256) (nullptr可)。補正後のヒストグラムで置き換える
+ */
+void applyContrast(GrayImage &img, ContrastMode mode, int *hist) {
+    if (mode == CONTRAST_EQUALIZE) {
+        if (hist == nullptr) {
+            applyEqualization(img);
+            return;
+        }
+
+        // 変換表で移した先へ度数を移せば、補正後のヒストグラムになる
+        uint8_t table[256];
+        makeEqualizationTable(hist, table);
+        applyLookupTable(img, table);
+
+        int mapped[256] = {0};
+        for (int value = 0; value < 256; value++)
+            mapped[table[value]] += hist[value];
+        copy(mapped, mapped + 256, hist);
+    } else if (mode == CONTRAST_CLAHE) {
+        applyClahe(img);
+        if (hist != nullptr)
+            countHistogram(img, hist);
+    }
+}
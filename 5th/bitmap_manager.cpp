@@ -1,4 +1,12 @@
 #include "bitmap_manager.hpp"
+#include "pixel_convert.hpp"
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -11,17 +19,486 @@ using namespace std;
 * @return 変換された整数値
 */
 int bit2Integer(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4) {
-    return b1 +
-            b2 * 256 +
-            b3 * 256 * 256 +
-            b4 * 256 * 256 * 256;
+    // 負の値 (トップダウンの高さ) でもオーバーフローしないよう、符号なしで組み立てる
+    return (int)((uint32_t)b1 |
+            (uint32_t)b2 << 8 |
+            (uint32_t)b3 << 16 |
+            (uint32_t)b4 << 24);
+}
+
+/*
+* @fn Int整数値を4ビット情報に変換 (bit2Integerの逆変換)
+* @param value 変換する整数値
+* @param dst 書き込み先 (最下位ビットから4つ)
+*/
+void integer2Bit(int value, uint8_t *dst) {
+    dst[0] = value & 0xff;
+    dst[1] = (value >> 8) & 0xff;
+    dst[2] = (value >> 16) & 0xff;
+    dst[3] = (value >> 24) & 0xff;
+}
+
+/*
+* @fn 1行あたりのバイト数 (4バイト境界に揃えたもの) を求める
+* @param width 画像の幅
+* @param bitParPixel 1ピクセルあたりのビット数
+* @return 1行のバイト数
+*/
+int rowStride(int width, int bitParPixel) {
+    return ((width * bitParPixel + 31) / 32) * 4;
+}
+
+/**
+ * @fn ファイルヘッダーのバイト列を解釈する
+ * @param data ファイルヘッダーのバイト列 (FILE_HEADER_SIZE)
+ * @param fileHeader 格納先
+ */
+void parseFileHeader(const uint8_t *data, FileHeader &fileHeader) {
+    // ストア用にオリジナルデータ保存
+    memcpy(fileHeader.origData, data, FILE_HEADER_SIZE);
+
+    fileHeader.type = "";
+    fileHeader.type += data[0];
+    fileHeader.type += data[1];
+    fileHeader.size = bit2Integer(data[2], data[3], data[4], data[5]);
+    fileHeader.offset = bit2Integer(data[10], data[11], data[12], data[13]);
+}
+
+/**
+ * @fn 情報ヘッダーのバイト列を解釈する
+ * @param data 情報ヘッダーのバイト列 (INFO_HEADER_SIZE)
+ * @param fileHeader 解釈済みのファイルヘッダー (データサイズの補完に用いる)
+ * @param infoHeader 格納先
+ */
+void parseInfoHeader(const uint8_t *data, const FileHeader &fileHeader, InfoHeader &infoHeader) {
+    // ストア用にオリジナルデータ保存
+    memcpy(infoHeader.origData, data, INFO_HEADER_SIZE);
+
+    infoHeader.infoHeaderSize = bit2Integer(data[0], data[1], data[2], data[3]);
+    infoHeader.width = bit2Integer(data[4], data[5], data[6], data[7]);
+    infoHeader.height = bit2Integer(data[8], data[9], data[10], data[11]);
+    infoHeader.colorParPixel = bit2Integer(data[14], data[15], 0, 0);
+    infoHeader.compression = bit2Integer(data[16], data[17], data[18], data[19]);
+    infoHeader.colorsUsed = bit2Integer(data[32], data[33], data[34], data[35]);
+
+    //! ヘッダ上でのデータサイズ
+    // データサイズは非圧縮の場合0があり得るため、分岐させて各年
+    auto tempDataSize = bit2Integer(data[20], data[21], data[22], data[23]);
+    infoHeader.dataSize = tempDataSize == 0 ? fileHeader.size - fileHeader.offset : tempDataSize;
+}
+
+/**
+ * @fn 無圧縮ビットマップのヘッダーを作成する (8bit以下のときはグレイスケールのパレットを伴う)
+ * @param width 画像の幅
+ * @param height 画像の高さ
+ * @param bitParPixel 1ピクセルあたりのビット数
+ * @param fileHeader 格納先 (ファイルヘッダー)
+ * @param infoHeader 格納先 (情報ヘッダー)
+ */
+void buildHeaders(int width, int height, int bitParPixel, FileHeader &fileHeader, InfoHeader &infoHeader) {
+    //! ヘッダー上でのデータサイズ
+    int imageSize = rowStride(width, bitParPixel) * height;
+    //! パレットの色数 (8bit以下のときのみ)
+    int paletteColors = bitParPixel <= 8 ? (1 << bitParPixel) : 0;
+    //! 画素データまでのオフセット (パレットは1色4バイト)
+    int offset = FILE_HEADER_SIZE + INFO_HEADER_SIZE + 4 * paletteColors;
+
+    // ファイルヘッダー作成
+    memset(fileHeader.origData, 0, FILE_HEADER_SIZE);
+    fileHeader.origData[0] = 'B';
+    fileHeader.origData[1] = 'M';
+    integer2Bit(offset + imageSize, &fileHeader.origData[2]);
+    integer2Bit(offset, &fileHeader.origData[10]);
+
+    // 情報ヘッダー作成 (無圧縮、解像度は72dpi相当)
+    memset(infoHeader.origData, 0, INFO_HEADER_SIZE);
+    integer2Bit(INFO_HEADER_SIZE, &infoHeader.origData[0]);
+    integer2Bit(width, &infoHeader.origData[4]);
+    integer2Bit(height, &infoHeader.origData[8]);
+    infoHeader.origData[12] = 1;
+    infoHeader.origData[14] = bitParPixel;
+    integer2Bit(imageSize, &infoHeader.origData[20]);
+    integer2Bit(2835, &infoHeader.origData[24]);
+    integer2Bit(2835, &infoHeader.origData[28]);
+    integer2Bit(paletteColors, &infoHeader.origData[32]);
+
+    // 作成したバイト列から各値を設定
+    parseFileHeader(fileHeader.origData, fileHeader);
+    parseInfoHeader(infoHeader.origData, fileHeader, infoHeader);
+}
+
+/**
+ * @fn グレイスケールのカラーパレットをバイト列の末尾に追加する
+ * @details 0から255まで等間隔に並べた (1 << bitParPixel) 色を B, G, R, 予約 の順で追加する
+ * @param dst 追加先
+ * @param bitParPixel 1ピクセルあたりのビット数 (8以下)
+ */
+void appendGrayPalette(vector<uint8_t> &dst, int bitParPixel) {
+    //! パレットの色数
+    int colors = 1 << bitParPixel;
+
+    for (int i = 0; i < colors; i++) {
+        uint8_t value = i * 255 / (colors - 1);
+        dst.push_back(value);
+        dst.push_back(value);
+        dst.push_back(value);
+        dst.push_back(0);
+    }
+}
+
+/**
+ * @fn グレイスケールのカラーパレットを書き出す
+ * @param out 書き出し先
+ * @param bitParPixel 1ピクセルあたりのビット数 (8以下)
+ */
+void writeGrayPalette(FILE *out, int bitParPixel) {
+    //! パレットのバイト列
+    vector<uint8_t> palette;
+    appendGrayPalette(palette, bitParPixel);
+
+    fwrite(palette.data(), sizeof(uint8_t), palette.size(), out);
+}
+
+/**
+ * @fn ヘッダーのみを読み込み、画像の情報を取得する
+ * @details ファイルヘッダーと情報ヘッダー (54バイト) を1回のpreadで読み込む。
+ *          画素データは読まないため、大量のファイルのサイズ確認などに用いる
+ * @param filename ファイル名
+ * @param probe 格納先
+ * @return 読み込めたかどうか
+ */
+bool probeBitmap(string filename, BitmapProbe &probe) {
+    int fd = open(filename.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        return false;
+
+    //! ヘッダーのバイト列
+    uint8_t data[FILE_HEADER_SIZE + INFO_HEADER_SIZE];
+    ssize_t count = pread(fd, data, sizeof data, 0);
+    close(fd);
+
+    if (count != (ssize_t)sizeof data || data[0] != 'B' || data[1] != 'M')
+        return false;
+
+    FileHeader fileHeader;
+    InfoHeader infoHeader;
+    parseFileHeader(data, fileHeader);
+    parseInfoHeader(data + FILE_HEADER_SIZE, fileHeader, infoHeader);
+
+    probe.fileSize = fileHeader.size;
+    probe.width = infoHeader.width;
+    probe.height = abs(infoHeader.height);
+    probe.bitParPixel = infoHeader.colorParPixel;
+    probe.dataSize = infoHeader.dataSize;
+    probe.topdown = infoHeader.height < 0;
+
+    return true;
+}
+
+/**
+ * @fn 複数ファイルのヘッダー情報を一覧で標準出力に表示
+ * @details 1ファイル1行で、ファイル名・幅・高さ・ビット数・画素データサイズ・ファイルサイズをタブ区切りで出力する
+ * @param count ファイル数
+ * @param files ファイル名の配列
+ * @return 読み込めなかったファイルの数
+ */
+int probeFiles(int count, char *files[]) {
+    //! 読み込めなかったファイルの数
+    int failed = 0;
+    BitmapProbe probe;
+
+    cout << "# file\twidth\theight\tbpp\tdataSize\tfileSize" << endl;
+
+    for (int i = 0; i < count; i++) {
+        if (!probeBitmap(files[i], probe)) {
+            cerr << "Error: can't probe " << files[i] << "." << endl;
+            failed++;
+            continue;
+        }
+
+        cout << files[i] << "\t" << probe.width << "\t" << probe.height << "\t" << probe.bitParPixel
+             << "\t" << probe.dataSize << "\t" << probe.fileSize << endl;
+    }
+
+    return failed;
+}
+
+/**
+ * @fn まとめたビットマップをファイルへ書き出す
+ * @details ヘッダーと画素データをwritevで1回のシステムコールで書き出す (途中までしか書けなかった場合は続きを書く)。
+ *          fsyncは行わない
+ * @param filename ファイルの名前
+ * @param bmp 書き出すビットマップ
+ * @return 書き出せたかどうか
+ */
+bool writeEncodedBitmap(string filename, const EncodedBitmap &bmp) {
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        cout << "Error: 書き出し先のファイルを開けません。" << endl;
+        return false;
+    }
+
+    //! ヘッダーと画素データ
+    struct iovec iov[2];
+    iov[0].iov_base = (void *)bmp.header.data();
+    iov[0].iov_len = bmp.header.size();
+    iov[1].iov_base = (void *)bmp.data;
+    iov[1].iov_len = bmp.size;
+
+    //! 未書き出しの先頭
+    struct iovec *rest = iov;
+    int restCount = 2;
+
+    while (restCount > 0) {
+        ssize_t written = writev(fd, rest, restCount);
+
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            cout << "Error: " << filename << " の書き出しに失敗しました。" << endl;
+            close(fd);
+            return false;
+        }
+
+        // 書き出し済みの分を進める
+        while (restCount > 0 && (size_t)written >= rest->iov_len) {
+            written -= rest->iov_len;
+            rest++;
+            restCount--;
+        }
+        if (restCount > 0) {
+            rest->iov_base = (uint8_t *)rest->iov_base + written;
+            rest->iov_len -= written;
+        }
+    }
+
+    close(fd);
+    return true;
+}
+
+/**
+ * @fn 1行分の画素を1bitに詰める
+ * @param src 行の先頭
+ * @param step 1画素あたりのバイト数
+ * @param width 画像の幅
+ * @param dst 書き込み先 (rowStride(width, 1)バイト)
+ */
+static void packBinaryRow(const uint8_t *src, int step, int width, uint8_t *dst) {
+    memset(dst, 0, rowStride(width, 1));
+
+    for (int col = 0; col < width; col++) {
+        // 上位ビットから左の画素を詰める
+        if (src[col * step] >= 128)
+            dst[col >> 3] |= 0x80 >> (col & 7);
+    }
+}
+
+/**
+ * @fn 1行分の画素をBI_RLE8で圧縮する
+ * @details 2画素以上同じ値が続く区間は (個数, 値)、続かない区間は3画素以上なら絶対モード
+ *          (0, 個数, 値..., 偶数バイトに揃える0) で書き、最後に行末 (0, 0) を置く。
+ *          出力は最大で 2 * width + 2 バイト
+ * @param src 行の先頭
+ * @param step 1画素あたりのバイト数
+ * @param width 画像の幅
+ * @param dst 書き込み先
+ * @return 書き込んだバイト数
+ */
+static size_t encodeRle8Row(const uint8_t *src, int step, int width, uint8_t *dst) {
+    //! 書き込んだバイト数
+    size_t count = 0;
+    int col = 0;
+
+    while (col < width) {
+        //! 同じ値が続く長さ
+        int run = 1;
+        while (col + run < width && run < 255 && src[(col + run) * step] == src[col * step])
+            run++;
+
+        if (run >= 2) {
+            dst[count++] = run;
+            dst[count++] = src[col * step];
+            col += run;
+            continue;
+        }
+
+        //! 同じ値が続かない長さ (次に同じ値が2つ続く位置まで)
+        int literal = 1;
+        while (col + literal < width && literal < 255
+               && !(col + literal + 1 < width && src[(col + literal) * step] == src[(col + literal + 1) * step]))
+            literal++;
+
+        if (literal < 3) {
+            // 絶対モードは3画素以上のみのため、1画素ずつの繰り返しとして書く
+            for (int i = 0; i < literal; i++) {
+                dst[count++] = 1;
+                dst[count++] = src[(col + i) * step];
+            }
+        } else {
+            dst[count++] = 0;
+            dst[count++] = literal;
+            for (int i = 0; i < literal; i++)
+                dst[count++] = src[(col + i) * step];
+            if (literal & 1)
+                dst[count++] = 0;
+        }
+        col += literal;
+    }
+
+    // 行末
+    dst[count++] = 0;
+    dst[count++] = 0;
+
+    return count;
+}
+
+/**
+ * @fn グレイスケールの画素を1bit白黒、またはBI_RLE8形式のビットマップとしてまとめる
+ * @details 画素データは新たに確保した領域へ変換する。24bit画像から変換する場合は
+ *          pixelsにRの位置、stepに3を渡す
+ * @param pixels 画素データの先頭 (ファイルと同じく下の行から並ぶ)
+ * @param srcStride 1行あたりのバイト数
+ * @param step 1画素あたりのバイト数
+ * @param width 画像の幅
+ * @param height 画像の高さ
+ * @param format 書き出し形式 (WRITE_1BIT, WRITE_RLE8)
+ * @param bmp 格納先
+ */
+void encodeGrayPixels(const uint8_t *pixels, int srcStride, int step, int width, int height,
+                      WriteFormat format, EncodedBitmap &bmp) {
+    //! 1ピクセルあたりのビット数
+    int bitParPixel = format == WRITE_1BIT ? 1 : 8;
+
+    FileHeader fileHeader;
+    InfoHeader infoHeader;
+    buildHeaders(width, height, bitParPixel, fileHeader, infoHeader);
+
+    //! 画素データの最大サイズ (RLE8は各行の最大サイズ + 終端)
+    size_t capacity = format == WRITE_1BIT ? (size_t)infoHeader.dataSize : (size_t)(2 * width + 2) * height + 2;
+    bmp.buffer = std::make_shared<PixelBuffer>(capacity);
+
+    //! 書き込み先
+    uint8_t *dst = bmp.buffer->getData();
+    //! 画素データのサイズ
+    size_t size = 0;
+
+    if (format == WRITE_1BIT) {
+        //! 出力の1行あたりのバイト数
+        int dstStride = rowStride(width, 1);
+
+        for (int row = 0; row < height; row++)
+            packBinaryRow(pixels + row * srcStride, step, width, dst + row * dstStride);
+        size = infoHeader.dataSize;
+    } else {
+        for (int row = 0; row < height; row++)
+            size += encodeRle8Row(pixels + row * srcStride, step, width, dst + size);
+
+        // ビットマップの終端
+        dst[size++] = 0;
+        dst[size++] = 1;
+
+        // 圧縮形式と圧縮後のサイズをヘッダーへ反映
+        integer2Bit(fileHeader.offset + size, &fileHeader.origData[2]);
+        integer2Bit(1, &infoHeader.origData[16]);
+        integer2Bit(size, &infoHeader.origData[20]);
+    }
+
+    // ヘッダー、パレット
+    bmp.header.assign(fileHeader.origData, fileHeader.origData + FILE_HEADER_SIZE);
+    bmp.header.insert(bmp.header.end(), infoHeader.origData, infoHeader.origData + INFO_HEADER_SIZE);
+    appendGrayPalette(bmp.header, bitParPixel);
+
+    bmp.data = dst;
+    bmp.size = size;
+}
+
+/**
+ * @fn 画素データの領域をBufferPoolから確保する
+ * @param size 領域のサイズ
+ */
+PixelBuffer::PixelBuffer(size_t size) {
+    this->block = BufferPool::instance().acquire(size);
+    this->data = block.data;
+    this->size = size;
+    this->mappedData = nullptr;
+    this->mappedSize = 0;
+}
+
+/**
+ * @fn マッピングした領域の一部を画素データとする
+ * @details マッピングの解放はこのクラスが行う
+ * @param mappedData マッピングの先頭
+ * @param mappedSize マッピングのサイズ
+ * @param offset 画素データまでのオフセット
+ * @param size 画素データのサイズ
+ */
+PixelBuffer::PixelBuffer(uint8_t *mappedData, size_t mappedSize, size_t offset, size_t size) {
+    this->block = {nullptr, 0, false};
+    this->data = mappedData + offset;
+    this->size = size;
+    this->mappedData = mappedData;
+    this->mappedSize = mappedSize;
+}
+
+/**
+ * @fn 確保の方法に応じて、munmapまたはBufferPoolへの返却を行う
+ */
+PixelBuffer::~PixelBuffer() {
+    if (mappedData != nullptr)
+        munmap(mappedData, mappedSize);
+    else
+        BufferPool::instance().release(block);
+}
+
+/**
+ * @fn ムーブコンストラクタ
+ * @details 画素データとファイルの所有権を移し、srcは空の状態にする
+ * @param src 移動元
+ */
+BitmapManager::BitmapManager(BitmapManager &&src) {
+    file = nullptr;
+    image = nullptr;
+    stride = 0;
+    *this = std::move(src);
+}
+
+/**
+ * @fn ムーブ代入
+ * @details 画素データとファイルの所有権を移し、srcは空の状態にする
+ * @param src 移動元
+ * @return 自身
+ */
+BitmapManager &BitmapManager::operator=(BitmapManager &&src) {
+    if (this == &src)
+        return *this;
+
+    if (file != nullptr)
+        fclose(file);
+
+    file = src.file;
+    image = src.image;
+    buffer = std::move(src.buffer);
+    fileHeader = src.fileHeader;
+    infoHeader = src.infoHeader;
+    stride = src.stride;
+    is_topdown = src.is_topdown;
+
+    src.file = nullptr;
+    src.image = nullptr;
+    src.stride = 0;
+
+    return *this;
 }
 
 /**
  * @fn ビットマップデータをヘッダー・データに分けて読み込み
+ * @details 開けない・未対応の形式・データが足りないなどで失敗したときは、空の画像 (幅・高さ0) となる
  * @param filenameファイル名
+ * @param mode 画素データの読み込み方法 (LOAD_COPY or LOAD_MMAP)
  */
-void BitmapManager::loadData(string filename) {
+void BitmapManager::loadData(string filename, LoadMode mode) {
     if (file != NULL){
         fclose(file);
     }
@@ -31,72 +508,82 @@ void BitmapManager::loadData(string filename) {
 
     if (file == NULL) {
         cout << "Error: can't open " << filename << "." << endl;
+        resetImage();
         return;
     }
 
     // 各種ロード用関数読み込み
     readFileHeader();
     readInfoHeader();
-    readImageData();
+
+    //! 1ピクセルあたりのビット数
+    int bpp = infoHeader.colorParPixel;
+    if ((bpp != 8 && bpp != 24 && bpp != 32) || !(infoHeader.compression == 0 || (bpp == 32 && infoHeader.compression == 3))) {
+        cout << "Error: 未対応の形式 (" << bpp << "bit, 圧縮形式 " << infoHeader.compression << ")" << endl;
+        resetImage();
+        return;
+    }
+
+    if (mode == LOAD_MMAP)
+        mapImageData();
+    else
+        readImageData();
+
+    // 読み込みに失敗したときは、前の画像やヘッダーを残さず空の画像とする
+    if (image == nullptr)
+        resetImage();
 }
 
 /**
  * @fn ファイルヘッダーをロードする
  */
 void BitmapManager::readFileHeader() {
-    //! データ格納関数
-    uint8_t data[FILE_HEADER_SIZE];
+    //! データ格納関数 (読み込めなかった部分は0のままとし、未対応の形式として扱われる)
+    uint8_t data[FILE_HEADER_SIZE] = {};
 
-    //! 読み込んだ文字数、freadで読み込み
-    size_t count = fread(data, sizeof(uint8_t), FILE_HEADER_SIZE, file);
+    // freadで読み込み
+    if (fread(data, sizeof(uint8_t), FILE_HEADER_SIZE, file) != FILE_HEADER_SIZE)
+        cout << "Error: ファイルヘッダーの読み込みに失敗" << endl;
 
-    // ストア用にオリジナルデータ保存
-    memcpy(fileHeader.origData, data, sizeof data);
-
-    fileHeader.type = "";
-    fileHeader.type += data[0];
-    fileHeader.type += data[1];
-    fileHeader.size = bit2Integer(data[2], data[3], data[4], data[5]);
+    parseFileHeader(data, fileHeader);
 }
 
 /**
  * @fn ファイルヘッダーをロードする
  */
 void BitmapManager::readInfoHeader() {
-    uint8_t data[INFO_HEADER_SIZE];
-    size_t count = fread(data, sizeof(uint8_t), INFO_HEADER_SIZE, file);
-
-    // ストア用にオリジナルデータ保存
-    memcpy(infoHeader.origData, data, sizeof data);
+    uint8_t data[INFO_HEADER_SIZE] = {};
+    if (fread(data, sizeof(uint8_t), INFO_HEADER_SIZE, file) != INFO_HEADER_SIZE)
+        cout << "Error: 情報ヘッダーの読み込みに失敗" << endl;
 
-    infoHeader.infoHeaderSize = bit2Integer(data[0], data[1], data[2], data[3]);
-    infoHeader.width = bit2Integer(data[4], data[5], data[6], data[7]);
-    infoHeader.height = bit2Integer(data[8], data[9], data[10], data[11]);
-    infoHeader.colorParPixel = bit2Integer(data[14], data[15], 0, 0);
+    parseInfoHeader(data, fileHeader, infoHeader);
+    stride = rowStride(infoHeader.width, 24);
 
-    //! ヘッダ上でのデータサイズ
-    // データサイズは非圧縮の場合0があり得るため、分岐させて各年
-    auto tempDataSize = bit2Integer(data[20], data[21], data[22], data[23]);
-    infoHeader.dataSize = tempDataSize == 0 ? fileHeader.size - 54 : tempDataSize;
-
-    //　高さがマイナスの場合、トップダウンであるためフラグを立てる
-    if (infoHeader.height < 0)  is_topdown = true;
+    //　高さがマイナスの場合、トップダウンであるためフラグを立てる (画素データは読み込み時にボトムアップへ変換する)
+    is_topdown = infoHeader.height < 0;
 }
 
 /**
  * @fn 画像データを読みこむ
+ * @details 24bitボトムアップ以外の形式は、読み込んだ後に24bitボトムアップへ変換する
  */
 void BitmapManager::readImageData() {
     // すでにimageがあったら削除
-    if (image != NULL) {
-        delete[] image;
+    releaseImage();
+
+    //! 情報ヘッダーの後ろから画素データまでのバイト列 (拡張された情報ヘッダー、ビットマスク、パレット)
+    vector<uint8_t> extra(max(fileHeader.offset - FILE_HEADER_SIZE - INFO_HEADER_SIZE, 0));
+    if (fread(extra.data(), sizeof(uint8_t), extra.size(), file) != extra.size()) {
+        cout << "Error: パレットの読み込みに失敗" << endl;
+        return;
     }
 
-    //! ヘッダーで定義されているデータサイズ
-    int imageSize = infoHeader.dataSize;
+    //! ファイル上の画素データのサイズ
+    int imageSize = sourceDataSize();
 
     // インスタンス変数のポインタへ領域確保
-    image = new uint8_t[imageSize];
+    buffer = std::make_shared<PixelBuffer>(imageSize);
+    image = buffer->getData();
 
     //! 読み込んだデータ数、freadで読み込み
     int count = fread(image, sizeof(uint8_t), imageSize, file);
@@ -106,28 +593,231 @@ void BitmapManager::readImageData() {
         cout << "Error: ヘッダーの画像サイズと実際の画像サイズが矛盾" << endl;
         cout << "count:  " << count << endl;
         cout << "header: " << imageSize << endl;
+        releaseImage();
         return;
     }
+
+    if (!isInternalLayout()) {
+        //! 変換前の画素データ (変換後に手放す)
+        PixelBufferPtr source = buffer;
+        unpackImage(source->getData(), extra.data(), extra.size());
+    }
+}
+
+/**
+ * @fn 画像データをファイルのプライベートマッピングとして読み込む
+ * @details 画素データはコピーせず、ページキャッシュ上のデータを直接参照する。
+ *          MAP_PRIVATEのため、setColorで書き込んだページのみコピーされ、元ファイルは変更されない
+ */
+void BitmapManager::mapImageData() {
+    // すでにimageがあったら削除
+    releaseImage();
+
+    //! ファイルの実サイズ
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0) {
+        cout << "Error: fstatに失敗" << endl;
+        return;
+    }
+
+    //! ファイル上の画素データのサイズ
+    size_t imageSize = sourceDataSize();
+
+    // ヘッダーの画像サイズ分のデータが存在しないとき、エラー処理
+    if (fileHeader.offset < FILE_HEADER_SIZE + INFO_HEADER_SIZE
+        || (size_t)fileHeader.offset + imageSize > (size_t)st.st_size) {
+        cout << "Error: ヘッダーの画像サイズと実際の画像サイズが矛盾" << endl;
+        cout << "file:   " << st.st_size << endl;
+        cout << "header: " << fileHeader.offset + imageSize << endl;
+        return;
+    }
+
+    void *addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), 0);
+    if (addr == MAP_FAILED) {
+        cout << "Error: mmapに失敗" << endl;
+        return;
+    }
+
+    // 先頭から順に走査する処理が多いため、先読みを促す
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+    buffer = std::make_shared<PixelBuffer>((uint8_t *)addr, st.st_size, fileHeader.offset, imageSize);
+    image = buffer->getData();
+
+    // 24bitボトムアップ以外の形式は変換する (変換後はマッピングを手放す)
+    if (!isInternalLayout()) {
+        PixelBufferPtr source = buffer;
+        unpackImage(source->getData(), (uint8_t *)addr + FILE_HEADER_SIZE + INFO_HEADER_SIZE,
+                    fileHeader.offset - FILE_HEADER_SIZE - INFO_HEADER_SIZE);
+    }
+
+    // マッピング後はファイルを開いておく必要がない
+    fclose(file);
+    file = nullptr;
+}
+
+/**
+ * @fn ファイル上の画素データが内部の形式 (24bit、ボトムアップ、無圧縮) かどうか
+ * @return 内部の形式であればtrue (読み込んだデータをそのまま用いる)
+ */
+bool BitmapManager::isInternalLayout() {
+    return infoHeader.colorParPixel == 24 && infoHeader.height > 0 && infoHeader.compression == 0;
+}
+
+/**
+ * @fn ファイル上の画素データのサイズ
+ * @details 内部の形式のときはヘッダーの値、それ以外は幅・高さ・ビット数から求めた値
+ * @return サイズ
+ */
+size_t BitmapManager::sourceDataSize() {
+    if (isInternalLayout())
+        return infoHeader.dataSize;
+
+    return (size_t)rowStride(infoHeader.width, infoHeader.colorParPixel) * abs(infoHeader.height);
+}
+
+/**
+ * @fn 8/24/32bit、トップダウンの画素データを24bitボトムアップへ変換する
+ * @details 変換後の画素データは新たに確保し、ヘッダーも24bitボトムアップのものに作り直す。
+ *          32bitのビットフィールドは B, G, R, A の並び (標準のマスク) のみ扱う
+ * @param pixels ファイル上の画素データ
+ * @param extra 情報ヘッダーの後ろから画素データまでのバイト列
+ * @param extraSize extraのサイズ
+ */
+void BitmapManager::unpackImage(const uint8_t *pixels, const uint8_t *extra, size_t extraSize) {
+    //! 元画像の形式
+    int width = infoHeader.width;
+    int height = abs(infoHeader.height);
+    int bpp = infoHeader.colorParPixel;
+    int srcStride = rowStride(width, bpp);
+    bool topdown = infoHeader.height < 0;
+
+    // ビットフィールドのマスクは情報ヘッダーの直後 (V4以降のヘッダーでは情報ヘッダー内の同じ位置) にある
+    if (infoHeader.compression == 3) {
+        if (extraSize < 12 || bit2Integer(extra[0], extra[1], extra[2], extra[3]) != 0x00ff0000
+            || bit2Integer(extra[4], extra[5], extra[6], extra[7]) != 0x0000ff00
+            || bit2Integer(extra[8], extra[9], extra[10], extra[11]) != 0x000000ff) {
+            cout << "Error: 未対応のビットマスク" << endl;
+            releaseImage();
+            return;
+        }
+    }
+
+    //! パレット (256色分、足りない色は黒)
+    uint8_t palette[4 * 256] = {0};
+    //! パレットの色数
+    int colors = 0;
+
+    if (bpp == 8) {
+        //! パレットの位置 (拡張された情報ヘッダーの後ろ)
+        size_t paletteOffset = infoHeader.infoHeaderSize - INFO_HEADER_SIZE;
+        colors = infoHeader.colorsUsed > 0 && infoHeader.colorsUsed < 256 ? infoHeader.colorsUsed : 256;
+
+        if (paletteOffset + 4 * colors > extraSize) {
+            cout << "Error: パレットの読み込みに失敗" << endl;
+            releaseImage();
+            return;
+        }
+        memcpy(palette, extra + paletteOffset, 4 * colors);
+    }
+
+    //! パレットがグレイスケールの恒等変換かどうか (値を3つ並べるだけでよい)
+    bool grayPalette = bpp == 8 && isGrayPalette(palette, colors);
+
+    // 24bitボトムアップのヘッダーを作成
+    buildHeaders(width, height, 24, fileHeader, infoHeader);
+    stride = rowStride(width, 24);
+    is_topdown = topdown;
+
+    buffer = std::make_shared<PixelBuffer>(infoHeader.dataSize);
+    image = buffer->getData();
+
+    for (int row = 0; row < height; row++) {
+        //! 変換元の行 (トップダウンのときは上下を反転)
+        const uint8_t *src = pixels + (size_t)(topdown ? height - 1 - row : row) * srcStride;
+        //! 変換先の行
+        uint8_t *dst = image + (size_t)row * stride;
+
+        if (bpp == 32)
+            convertBgraToBgr(src, dst, width);
+        else if (bpp == 24)
+            memcpy(dst, src, 3 * width);
+        else if (grayPalette)
+            convertGrayToBgr(src, dst, width);
+        else
+            convertIndexedToBgr(src, palette, dst, width);
+
+        // 行末の詰め物
+        memset(dst + 3 * width, 0, stride - 3 * width);
+    }
+}
+
+/**
+ * @fn 画像データの領域を手放す
+ * @details 他の画像と共有していなければ、PixelBufferのデストラクタで解放される
+ */
+void BitmapManager::releaseImage() {
+    buffer.reset();
+    image = nullptr;
+}
+
+/**
+ * @fn 画素データを手放し、ヘッダーも空 (幅・高さ0) に戻す
+ * @details 読み込みに失敗したとき、前に読み込んだ画像を処理し続けないようにする
+ */
+void BitmapManager::resetImage() {
+    releaseImage();
+    fileHeader = FileHeader();
+    infoHeader = InfoHeader();
+    stride = 0;
+    is_topdown = false;
+}
+
+/**
+ * @fn 共有している画素データを複製し、この画像専用にする
+ */
+void BitmapManager::detach() {
+    //! 複製先
+    PixelBufferPtr newBuffer = std::make_shared<PixelBuffer>(infoHeader.dataSize);
+    memcpy(newBuffer->getData(), image, infoHeader.dataSize);
+
+    buffer = newBuffer;
+    image = buffer->getData();
 }
 
 /**
  * @fn ビットマップデータのファイル書き出し
+ * @details ヘッダーと画素データを1回のwritevで書き出す
  * @param filename ファイルの名前
+ * @param format 書き出し形式 (既定は24bit)
  */
-void BitmapManager::writeData(string filename){
-    FILE *out = fopen(filename.c_str(), "wb");
+void BitmapManager::writeData(string filename, WriteFormat format){
+    EncodedBitmap bmp;
+    encode(bmp, format);
 
-    if (out == NULL)
-    cout << "Error: 書き出し先のファイルを開けません。" << endl;
+    writeEncodedBitmap(filename, bmp);
+}
 
-    // オリジナルデータをもとにヘッダー書き出し
-    fwrite(fileHeader.origData, sizeof(uint8_t), FILE_HEADER_SIZE, out);
-    fwrite(infoHeader.origData, sizeof(uint8_t), INFO_HEADER_SIZE, out);
+/**
+ * @fn 書き出し用にヘッダーと画素データをまとめる
+ * @details 24bit形式では画素データは複製せず共有する。以降にこの画像へ書き込むと、画像側が複製を作る。
+ *          1bit, RLE8形式はグレイスケール化済みの画像を対象とし、Rの値を用いる
+ * @param bmp 格納先
+ * @param format 書き出し形式
+ */
+void BitmapManager::encode(EncodedBitmap &bmp, WriteFormat format) {
+    if (format != WRITE_DEFAULT) {
+        encodeGrayPixels(image + 2, stride, 3, infoHeader.width, infoHeader.height, format, bmp);
+        return;
+    }
 
-    // データ書き出し
-    fwrite(image, sizeof(uint8_t), infoHeader.dataSize, out);
+    // オリジナルデータをもとにヘッダーを設定
+    bmp.header.assign(fileHeader.origData, fileHeader.origData + FILE_HEADER_SIZE);
+    bmp.header.insert(bmp.header.end(), infoHeader.origData, infoHeader.origData + INFO_HEADER_SIZE);
 
-    fclose(out);
+    bmp.buffer = buffer;
+    bmp.data = image;
+    bmp.size = infoHeader.dataSize;
 }
 
 /**
@@ -146,11 +836,12 @@ void BitmapManager::displayHeader() {
 /**
  * @fn 取り出す画素の位置を色ごとに指定
  * @param infoHeader 情報ヘッダー
+ * @param stride 1行あたりのバイト数
  * @param row 行
  * @param col 列
  * @return 各色の格納されている位置
  */
-ColorPosition getColorPosition(InfoHeader infoHeader, int row, int col) {
+ColorPosition getColorPosition(const InfoHeader &infoHeader, int stride, int row, int col) {
     // 範囲外かどうかを確認
     if (row < 0 || row >= infoHeader.height) {
         cout << "Error: getColor(): rowが範囲外" << endl;
@@ -162,12 +853,9 @@ ColorPosition getColorPosition(InfoHeader infoHeader, int row, int col) {
     }
 
     // 参考: http://coconut.sys.eng.shizuoka.ac.jp/bmp/
-    int width = 3 * infoHeader.width;
-    while (width % 4)  ++width;
-
     ColorPosition colorPos;
 
-    colorPos.b = row * width + 3 * col;
+    colorPos.b = row * stride + 3 * col;
     colorPos.g = colorPos.b + 1;
     colorPos.r = colorPos.b + 2;
 
@@ -198,7 +886,7 @@ int BitmapManager::getHeight() {
  */
 Color BitmapManager::getColor(int row, int col){
     //! 指定した行と列のデータ上の位置を取得
-    ColorPosition pos = getColorPosition(infoHeader, row, col);
+    ColorPosition pos = getColorPosition(infoHeader, stride, row, col);
 
     // 色取得
     Color color;
@@ -219,7 +907,10 @@ Color BitmapManager::getColor(int row, int col){
  */
 void BitmapManager::setColor(int row, int col, int r, int g, int b) {
     //! 指定した行と列のデータ上の位置を取得
-    ColorPosition pos = getColorPosition(infoHeader, row, col);
+    ColorPosition pos = getColorPosition(infoHeader, stride, row, col);
+
+    // 共有中であれば複製してから書き込む
+    prepareWrite();
 
     // 色セット
     image[pos.r] = r;
@@ -227,11 +918,60 @@ void BitmapManager::setColor(int row, int col, int r, int g, int b) {
     image[pos.b] = b;
 }
 
+/**
+ * @fn stride getter
+ * @return 1行あたりのバイト数
+ */
+int BitmapManager::getStride() {
+    return stride;
+}
+
+/**
+ * @fn 指定された行の先頭を取得
+ * @details 共有中の画素データは、ここで複製してから返す (以降に共有した場合は取得し直すこと)
+ * @param row 行
+ * @return 行の先頭のポインタ
+ */
+uint8_t *BitmapManager::getRow(int row) {
+    prepareWrite();
+    return image + row * stride;
+}
+
+/**
+ * @fn 指定された行をBGR画素の配列として取得
+ * @details 共有中の画素データは、ここで複製してから返す (以降に共有した場合は取得し直すこと)
+ * @param row 行
+ * @return 行の先頭の画素 (width個の画素が連続して並ぶ)
+ */
+BgrPixel *BitmapManager::getBgrRow(int row) {
+    prepareWrite();
+    return (BgrPixel *)(image + row * stride);
+}
+
+/**
+ * @fn 指定された行の先頭を読み込み用に取得
+ * @details 共有中の画素データも複製せずにそのまま返す
+ * @param row 行
+ * @return 行の先頭のポインタ
+ */
+const uint8_t *BitmapManager::getConstRow(int row) {
+    return image + row * stride;
+}
+
+/**
+ * @fn 指定された行を読み込み用にBGR画素の配列として取得
+ * @param row 行
+ * @return 行の先頭の画素
+ */
+const BgrPixel *BitmapManager::getConstBgrRow(int row) {
+    return (const BgrPixel *)(image + row * stride);
+}
+
 FileHeader BitmapManager::getFileHeader(){
     return fileHeader;
 }
 
-void BitmapManager::setFileHeader(FileHeader FileHeader){
+void BitmapManager::setFileHeader(FileHeader fileHeader){
     this->fileHeader = fileHeader;
 }
 
@@ -239,27 +979,63 @@ InfoHeader BitmapManager::getInfoHeader(){
     return infoHeader;
 }
 
-void BitmapManager::setInfoHeader(InfoHeader InfoHeader){
+void BitmapManager::setInfoHeader(InfoHeader infoHeader){
     this->infoHeader = infoHeader;
 }
 
 // 参考: http://program.station.ez-net.jp/special/handbook/cpp/class/copy.asp
-void BitmapManager::copy(BitmapManager &src){
+/**
+ * @fn 画像をコピーする
+ * @param src コピー元
+ * @param copyOnWrite trueのとき画素データを共有し、どちらかが書き込むまで複製を遅らせる (O(1))
+ */
+void BitmapManager::copy(BitmapManager &src, bool copyOnWrite){
     // ヘッダーコピー
     fileHeader = src.getFileHeader();
     infoHeader = src.getInfoHeader();
+    stride = src.stride;
+    is_topdown = src.is_topdown;
 
     // すでにimageがあったら削除
-    if (image != NULL) {
-        delete[] image;
+    releaseImage();
+
+    // 共有する場合は参照を増やすのみ
+    if (copyOnWrite) {
+        buffer = src.buffer;
+        image = src.image;
+        return;
     }
 
     //! ヘッダーで定義されているデータサイズ
     int imageSize = infoHeader.dataSize;
 
     // インスタンス変数のポインタへ領域確保
-    image = new uint8_t[imageSize];
+    buffer = std::make_shared<PixelBuffer>(imageSize);
+    image = buffer->getData();
 
     // コピー
     memcpy(image, src.image, sizeof(uint8_t) * imageSize);
+}
+
+/**
+ * @fn 指定サイズの24bit画像を生成する
+ * @details ヘッダーを作成し、画素データの領域を確保する (画素値は0で初期化)。
+ *          同じサイズの領域を持っている場合は再確保せずに使い回す
+ * @param width 画像の幅
+ * @param height 画像の高さ
+ */
+void BitmapManager::create(int width, int height) {
+    //! 現在確保している領域のサイズ (共有中・マッピングの場合は使い回さない。use_count()の扱いはprepareWriteを参照)
+    int currentSize = (buffer && buffer.use_count() == 1 && !buffer->isMapped()) ? infoHeader.dataSize : -1;
+
+    buildHeaders(width, height, 24, fileHeader, infoHeader);
+    stride = rowStride(width, 24);
+    is_topdown = false;
+
+    if (currentSize != infoHeader.dataSize) {
+        buffer = std::make_shared<PixelBuffer>(infoHeader.dataSize);
+        image = buffer->getData();
+    }
+
+    memset(image, 0, infoHeader.dataSize);
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include "gray_image.hpp"
+
+//! @def ヒストグラムの図の大きさ (1階調あたり2画素の幅)
+#define HISTOGRAM_PLOT_WIDTH 512
+#define HISTOGRAM_PLOT_HEIGHT 256
+
+/**
+ * @brief ヒストグラムの出力先
+ */
+enum HistogramBackend {
+    HISTOGRAM_BUILTIN,  // CSV, JSON, BMPの図をプロセス内で書き出す
+    HISTOGRAM_GNUPLOT   // gnuplotを起動してPNGの図を書き出す
+};
+
+//! @def 標本化の既定の間隔
+#define SAMPLE_STEP 4
+//! @def 標本を選ぶ乱数の既定のシード (同じ画像からは毎回同じ標本を選ぶ)
+#define SAMPLE_SEED 1
+
+/**
+ * @brief ヒストグラムを推定するときの標本の取り方 (いずれも乱数で重複を許して選ぶ)
+ */
+enum SampleMode {
+    SAMPLE_PIXELS,  // 画素を選ぶ (全体の約1/step^2個)
+    SAMPLE_ROWS     // 行を選び、その行の画素をすべて使う (全体の約1/step行。行単位でSIMDの変換を用いるが、誤差の上限は大きくなる)
+};
+
+/**
+ * @brief 標本から推定したヒストグラムの情報
+ */
+struct HistogramSample {
+    long long samples;  // 標本の画素数
+    double errorBound;  // 正規化した累積分布の、全画素との差の上限 (95%信頼。全画素のときは0)
+};
+
+HistogramSample sampleHistogram(BitmapManager &src, int *count, int step, SampleMode mode = SAMPLE_PIXELS,
+                                unsigned seed = SAMPLE_SEED);  // カラー画像の一部の画素からヒストグラムを推定
+double compareHistograms(const int *full, const int *sampled);  // 正規化した累積分布の差の最大値
+
+/**
+ * @brief ヒストグラムから求める画像の統計量
+ * @details グレイスケール化で集計したヒストグラムから累積度数・累積和を一度だけ求め、
+ *          以降の問い合わせは画素を読み直さずO(256)以下で答える
+ */
+class HistogramStats {
+    // フィールド定義
+    long long cumCount[256];  // [0, i] の画素数
+    long long sum;  // 画素値の合計
+    long long squareSum;  // 画素値の2乗の合計
+    double entropy;  // エントロピー [bit]
+
+public:
+    // コンストラクタ
+    explicit HistogramStats(const int *count);  // count: ヒストグラム [0 256)
+
+    // メソッド定義
+    long long getTotal();  // 画素数
+    int getMin();  // 最小の画素値 (画素がなければ0)
+    int getMax();  // 最大の画素値 (画素がなければ0)
+    double getMean();  // 平均
+    double getVariance();  // 分散
+    double getStdDev();  // 標準偏差
+    int getPercentile(double percent);  // percent% 点の画素値 (0〜100)
+    int getMedian();  // 中央値 (50%点)
+    double getEntropy();  // エントロピー [bit] (0〜8)
+};
+
+bool writeHistogramCsv(std::string filename, const int *count);  // "value,count" の256行
+bool writeHistogramJson(std::string filename, const int *count);  // {"total": N, "count": [...]}
+void renderHistogram(const int *count, GrayImage &plot);  // 棒グラフを描画
+bool writeHistogramPlot(std::string filename, const int *count);  // 棒グラフを1bitのBMPで書き出し
+bool writeHistogramGnuplot(std::string filename, const int *count);  // gnuplotでPNGを書き出し
+
+#endif // HISTOGRAM_HPP
@@ -0,0 +1,449 @@
+#include "pixel_convert.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+//! @def SSSE3版の関数を用意するかどうか (実行時にCPUが対応しているか確認して使う)
+#define PIXEL_CONVERT_SSSE3
+#endif
+
+#ifdef PIXEL_CONVERT_SSSE3
+/**
+ * @fn CPUがSSSE3に対応しているかどうか
+ * @return 対応していればtrue
+ */
+static bool hasSsse3() {
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+}
+
+/**
+ * @fn CPUがAVX2に対応しているかどうか
+ * @return 対応していればtrue
+ */
+static bool hasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+/**
+ * @fn 32bit -> 24bit (SSSE3版)
+ * @details 4画素 (16バイト) ずつ読み、アルファを除いた12バイトへ並べ替えて16バイト書き込む。
+ *          余分な4バイトは次の4画素で上書きされるため、最後の数画素は1画素ずつ処理する
+ */
+__attribute__((target("ssse3")))
+static int convertBgraToBgrSsse3(const uint8_t *src, uint8_t *dst, int width) {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    int col = 0;
+
+    for (; col + 6 <= width; col += 4) {
+        __m128i bgra = _mm_loadu_si128((const __m128i *)(src + 4 * col));
+        _mm_storeu_si128((__m128i *)(dst + 3 * col), _mm_shuffle_epi8(bgra, shuffle));
+    }
+
+    return col;
+}
+
+/**
+ * @fn 8bit -> 24bit (SSSE3版)
+ * @details 16画素 (16バイト) ずつ読み、各値を3回ずつ並べた48バイトを書き込む
+ */
+__attribute__((target("ssse3")))
+static int convertGrayToBgrSsse3(const uint8_t *src, uint8_t *dst, int width) {
+    const __m128i shuffle0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+    const __m128i shuffle1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+    const __m128i shuffle2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+    int col = 0;
+
+    for (; col + 16 <= width; col += 16) {
+        __m128i gray = _mm_loadu_si128((const __m128i *)(src + col));
+        _mm_storeu_si128((__m128i *)(dst + 3 * col), _mm_shuffle_epi8(gray, shuffle0));
+        _mm_storeu_si128((__m128i *)(dst + 3 * col + 16), _mm_shuffle_epi8(gray, shuffle1));
+        _mm_storeu_si128((__m128i *)(dst + 3 * col + 32), _mm_shuffle_epi8(gray, shuffle2));
+    }
+
+    return col;
+}
+
+/**
+ * @fn 24bit -> グレイスケール (SSSE3版)
+ * @details 4画素 (12バイト) ごとに16バイト読み、pshufbで (B, G) と (R, 1) の16bitの組へ並べ替える。
+ *          pmaddwdで (B * wB + G * wG) と (R * wR + 1 * 丸め) を32bitで求めて足し、15bit右シフトする。
+ *          16画素ずつ処理し、読み込みが行末を越えない範囲まで行う
+ */
+__attribute__((target("ssse3")))
+static int convertBgrToGraySsse3(const uint8_t *src, uint8_t *dst, int width) {
+    const __m128i shuffleBg = _mm_setr_epi8(0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1, 9, -1, 10, -1);
+    const __m128i shuffleR = _mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1);
+    const __m128i one = _mm_set1_epi32(1 << 16);
+    const __m128i weightBg = _mm_set1_epi32(GRAY_WEIGHT_B | (GRAY_WEIGHT_G << 16));
+    const __m128i weightR = _mm_set1_epi32(GRAY_WEIGHT_R | (GRAY_ROUND << 16));
+    int col = 0;
+
+    for (; 3 * col + 52 <= 3 * width; col += 16) {
+        //! 4画素ずつの結果
+        __m128i sum[4];
+
+        for (int i = 0; i < 4; i++) {
+            __m128i bgr = _mm_loadu_si128((const __m128i *)(src + 3 * col + 12 * i));
+            __m128i bg = _mm_shuffle_epi8(bgr, shuffleBg);
+            __m128i r1 = _mm_or_si128(_mm_shuffle_epi8(bgr, shuffleR), one);
+            sum[i] = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(bg, weightBg), _mm_madd_epi16(r1, weightR)), 15);
+        }
+
+        __m128i gray16lo = _mm_packs_epi32(sum[0], sum[1]);
+        __m128i gray16hi = _mm_packs_epi32(sum[2], sum[3]);
+        _mm_storeu_si128((__m128i *)(dst + col), _mm_packus_epi16(gray16lo, gray16hi));
+    }
+
+    return col;
+}
+
+/**
+ * @fn 24bit -> グレイスケール (AVX2版)
+ * @details SSSE3版と同じ計算を、下位・上位128bitにそれぞれ4画素ずつ読み込んで8画素ずつ行う
+ */
+__attribute__((target("avx2")))
+static int convertBgrToGrayAvx2(const uint8_t *src, uint8_t *dst, int width) {
+    const __m256i shuffleBg = _mm256_setr_epi8(0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1, 9, -1, 10, -1,
+                                               0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1, 9, -1, 10, -1);
+    const __m256i shuffleR = _mm256_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1,
+                                              2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1);
+    const __m256i one = _mm256_set1_epi32(1 << 16);
+    const __m256i weightBg = _mm256_set1_epi32(GRAY_WEIGHT_B | (GRAY_WEIGHT_G << 16));
+    const __m256i weightR = _mm256_set1_epi32(GRAY_WEIGHT_R | (GRAY_ROUND << 16));
+    int col = 0;
+
+    for (; 3 * col + 100 <= 3 * width; col += 32) {
+        //! 8画素ずつの結果 (下位128bitに前半4画素、上位128bitに後半4画素)
+        __m256i sum[4];
+
+        for (int i = 0; i < 4; i++) {
+            const uint8_t *p = src + 3 * col + 24 * i;
+            __m256i bgr = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)p)),
+                                                  _mm_loadu_si128((const __m128i *)(p + 12)), 1);
+            __m256i bg = _mm256_shuffle_epi8(bgr, shuffleBg);
+            __m256i r1 = _mm256_or_si256(_mm256_shuffle_epi8(bgr, shuffleR), one);
+            sum[i] = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(bg, weightBg), _mm256_madd_epi16(r1, weightR)), 15);
+        }
+
+        // packはレーンごとに行われるため、並びを戻してから8bitへ詰める
+        __m256i gray16lo = _mm256_permute4x64_epi64(_mm256_packs_epi32(sum[0], sum[1]), 0xd8);
+        __m256i gray16hi = _mm256_permute4x64_epi64(_mm256_packs_epi32(sum[2], sum[3]), 0xd8);
+        __m256i gray8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(gray16lo, gray16hi), 0xd8);
+        _mm256_storeu_si256((__m256i *)(dst + col), gray8);
+    }
+
+    return col;
+}
+
+/**
+ * @fn 24bit 8画素を、B, G, Rごとの32bit整数へ分ける (AVX2)
+ * @details 下位・上位128bitに4画素 (12バイト) ずつ読み込み、pshufbで各成分を32bitへ広げる。
+ *          src から28バイトを読む
+ */
+__attribute__((target("avx2")))
+static inline void loadBgr8Avx2(const uint8_t *src, __m256i &b, __m256i &g, __m256i &r) {
+    const __m256i shuffleB = _mm256_setr_epi8(0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1,
+                                              0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1);
+    const __m256i shuffleG = _mm256_setr_epi8(1, -1, -1, -1, 4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1,
+                                              1, -1, -1, -1, 4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1);
+    const __m256i shuffleR = _mm256_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1,
+                                              2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1);
+    __m256i bgr = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)src)),
+                                          _mm_loadu_si128((const __m128i *)(src + 12)), 1);
+    b = _mm256_shuffle_epi8(bgr, shuffleB);
+    g = _mm256_shuffle_epi8(bgr, shuffleG);
+    r = _mm256_shuffle_epi8(bgr, shuffleR);
+}
+
+/**
+ * @fn 3成分の32bit整数 (0〜255) 8画素分を24bitで書き込む (AVX2)
+ * @details 各画素を c0 | c1 << 8 | c2 << 16 にまとめ、pshufbで12バイトずつ詰めて下位・上位128bitの順に書き込む。
+ *          dst から28バイトを書き込む (末尾の4バイトは次の8画素で上書きされる)
+ */
+__attribute__((target("avx2")))
+static inline void storeBgr8Avx2(uint8_t *dst, __m256i c0, __m256i c1, __m256i c2) {
+    const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                             0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m256i packed = _mm256_or_si256(c0, _mm256_or_si256(_mm256_slli_epi32(c1, 8), _mm256_slli_epi32(c2, 16)));
+    packed = _mm256_shuffle_epi8(packed, shuffle);
+    _mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(packed));
+    _mm_storeu_si128((__m128i *)(dst + 12), _mm256_extracti128_si256(packed, 1));
+}
+
+/**
+ * @fn 24bit -> HSV (AVX2版)
+ * @details 8画素ずつ32bitへ広げ、1画素ずつの処理と同じ順序のfloat演算で求める (結果は1画素ずつの処理と一致する)。
+ *          Hは最大の成分に応じた式を比較結果で選ぶ (R, G, Bの順に優先)
+ */
+__attribute__((target("avx2")))
+static int convertBgrToHsvAvx2(const uint8_t *src, uint8_t *dst, int width) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 scale30 = _mm256_set1_ps(30.0f);
+    const __m256 scale255 = _mm256_set1_ps(255.0f);
+    const __m256i hueMax = _mm256_set1_epi32(180);
+    int col = 0;
+
+    for (; 3 * col + 28 <= 3 * width; col += 8) {
+        __m256i b, g, r;
+        loadBgr8Avx2(src + 3 * col, b, g, r);
+
+        __m256i max = _mm256_max_epi32(_mm256_max_epi32(b, g), r);
+        __m256i min = _mm256_min_epi32(_mm256_min_epi32(b, g), r);
+        __m256 diff = _mm256_cvtepi32_ps(_mm256_sub_epi32(max, min));
+        __m256 maxF = _mm256_cvtepi32_ps(max);
+        //! 差が0の画素 (無彩色)
+        __m256 gray = _mm256_cmp_ps(diff, zero, _CMP_EQ_OQ);
+        //! 0除算を避けた除数
+        __m256 divisor = _mm256_blendv_ps(diff, _mm256_set1_ps(1.0f), gray);
+
+        // S = 255 * diff / max (maxが0のときは0)
+        __m256 saturation = _mm256_div_ps(_mm256_mul_ps(diff, scale255), _mm256_max_ps(maxF, _mm256_set1_ps(1.0f)));
+        __m256i s = _mm256_cvttps_epi32(_mm256_add_ps(saturation, half));
+
+        // H (単位は2度)
+        __m256 hueB = _mm256_add_ps(_mm256_set1_ps(120.0f),
+                                    _mm256_div_ps(_mm256_mul_ps(scale30, _mm256_cvtepi32_ps(_mm256_sub_epi32(r, g))), divisor));
+        __m256 hueG = _mm256_add_ps(_mm256_set1_ps(60.0f),
+                                    _mm256_div_ps(_mm256_mul_ps(scale30, _mm256_cvtepi32_ps(_mm256_sub_epi32(b, r))), divisor));
+        __m256 hueR = _mm256_div_ps(_mm256_mul_ps(scale30, _mm256_cvtepi32_ps(_mm256_sub_epi32(g, b))), divisor);
+        __m256 hue = _mm256_blendv_ps(hueB, hueG, _mm256_castsi256_ps(_mm256_cmpeq_epi32(max, g)));
+        hue = _mm256_blendv_ps(hue, hueR, _mm256_castsi256_ps(_mm256_cmpeq_epi32(max, r)));
+        hue = _mm256_add_ps(hue, _mm256_and_ps(_mm256_cmp_ps(hue, zero, _CMP_LT_OQ), _mm256_set1_ps(180.0f)));
+        hue = _mm256_andnot_ps(gray, hue);
+        __m256i h = _mm256_cvttps_epi32(_mm256_add_ps(hue, half));
+        h = _mm256_andnot_si256(_mm256_cmpeq_epi32(h, hueMax), h);
+
+        storeBgr8Avx2(dst + 3 * col, h, s, max);
+    }
+
+    return col;
+}
+
+/**
+ * @fn 24bit -> YCbCr (AVX2版)
+ * @details 8画素ずつ32bitへ広げて固定小数点で求め、飽和つきのpackで0〜255に収める
+ */
+__attribute__((target("avx2")))
+static int convertBgrToYcbcrAvx2(const uint8_t *src, uint8_t *dst, int width) {
+    const __m256i offset = _mm256_set1_epi32(YCBCR_OFFSET);
+    const __m256i round = _mm256_set1_epi32(YCBCR_ROUND);
+    int col = 0;
+
+    for (; 3 * col + 28 <= 3 * width; col += 8) {
+        __m256i b, g, r;
+        loadBgr8Avx2(src + 3 * col, b, g, r);
+
+        __m256i y = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(YCBCR_Y_R)),
+                                                      _mm256_mullo_epi32(g, _mm256_set1_epi32(YCBCR_Y_G))),
+                                     _mm256_add_epi32(_mm256_mullo_epi32(b, _mm256_set1_epi32(YCBCR_Y_B)), round));
+        __m256i cb = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(YCBCR_CB_R)),
+                                                       _mm256_mullo_epi32(g, _mm256_set1_epi32(YCBCR_CB_G))),
+                                      _mm256_add_epi32(_mm256_mullo_epi32(b, _mm256_set1_epi32(YCBCR_CB_B)), offset));
+        __m256i cr = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(YCBCR_CR_R)),
+                                                       _mm256_mullo_epi32(g, _mm256_set1_epi32(YCBCR_CR_G))),
+                                      _mm256_add_epi32(_mm256_mullo_epi32(b, _mm256_set1_epi32(YCBCR_CR_B)), offset));
+
+        // 0〜255に収める
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i max = _mm256_set1_epi32(255);
+        y = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(y, 14), zero), max);
+        cb = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(cb, 14), zero), max);
+        cr = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(cr, 14), zero), max);
+
+        storeBgr8Avx2(dst + 3 * col, y, cb, cr);
+    }
+
+    return col;
+}
+#endif
+
+/**
+ * @fn 32bit (B, G, R, A) の1行を24bit (B, G, R) へ変換する
+ * @param src 変換元の行 (4 * widthバイト)
+ * @param dst 変換先の行 (3 * widthバイト)
+ * @param width 画素数
+ */
+void convertBgraToBgr(const uint8_t *src, uint8_t *dst, int width) {
+    //! 変換済みの画素数
+    int col = 0;
+
+#ifdef PIXEL_CONVERT_SSSE3
+    if (hasSsse3())
+        col = convertBgraToBgrSsse3(src, dst, width);
+#endif
+
+    for (; col < width; col++) {
+        dst[3 * col + 0] = src[4 * col + 0];
+        dst[3 * col + 1] = src[4 * col + 1];
+        dst[3 * col + 2] = src[4 * col + 2];
+    }
+}
+
+/**
+ * @fn 8bitの値の1行を、B, G, Rに同じ値を持つ24bitへ変換する
+ * @param src 変換元の行 (widthバイト)
+ * @param dst 変換先の行 (3 * widthバイト)
+ * @param width 画素数
+ */
+void convertGrayToBgr(const uint8_t *src, uint8_t *dst, int width) {
+    //! 変換済みの画素数
+    int col = 0;
+
+#ifdef PIXEL_CONVERT_SSSE3
+    if (hasSsse3())
+        col = convertGrayToBgrSsse3(src, dst, width);
+#endif
+
+    for (; col < width; col++) {
+        dst[3 * col + 0] = src[col];
+        dst[3 * col + 1] = src[col];
+        dst[3 * col + 2] = src[col];
+    }
+}
+
+/**
+ * @fn 8bitパレット形式の1行を24bitへ変換する
+ * @param src 変換元の行 (widthバイト)
+ * @param palette パレット (1色4バイト: B, G, R, 予約。256色分)
+ * @param dst 変換先の行 (3 * widthバイト)
+ * @param width 画素数
+ */
+void convertIndexedToBgr(const uint8_t *src, const uint8_t *palette, uint8_t *dst, int width) {
+    for (int col = 0; col < width; col++) {
+        //! 画素の色
+        const uint8_t *color = palette + 4 * src[col];
+        dst[3 * col + 0] = color[0];
+        dst[3 * col + 1] = color[1];
+        dst[3 * col + 2] = color[2];
+    }
+}
+
+/**
+ * @fn パレットがグレイスケールの恒等変換 (i番目の色が (i, i, i)) かどうか
+ * @details 該当する場合はconvertGrayToBgrで変換できる
+ * @param palette パレット (1色4バイト)
+ * @param colors 色数
+ * @return 恒等変換であればtrue
+ */
+bool isGrayPalette(const uint8_t *palette, int colors) {
+    for (int i = 0; i < colors; i++) {
+        if (palette[4 * i + 0] != i || palette[4 * i + 1] != i || palette[4 * i + 2] != i)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @fn 24bit (B, G, R) の1行をグレイスケールへ変換する
+ * @details 0.3R + 0.59G + 0.11B を15bitの固定小数点で求める (誤差はpixel_convert.hppを参照)。
+ *          AVX2, SSSE3の順に使えるものを用いる
+ * @param src 変換元の行 (3 * widthバイト)
+ * @param dst 変換先の行 (widthバイト)
+ * @param width 画素数
+ */
+void convertBgrToGray(const uint8_t *src, uint8_t *dst, int width) {
+    //! 変換済みの画素数
+    int col = 0;
+
+#ifdef PIXEL_CONVERT_SSSE3
+    if (hasAvx2())
+        col = convertBgrToGrayAvx2(src, dst, width);
+    else if (hasSsse3())
+        col = convertBgrToGraySsse3(src, dst, width);
+#endif
+
+    for (; col < width; col++) {
+        dst[col] = (GRAY_WEIGHT_R * src[3 * col + 2] + GRAY_WEIGHT_G * src[3 * col + 1]
+                    + GRAY_WEIGHT_B * src[3 * col] + GRAY_ROUND) >> 15;
+    }
+}
+
+/**
+ * @fn 8bitの値の1行を変換表で置き換える
+ * @details 1画素ずつ表を引く。pshufbで16要素ずつの表を16回引くSIMD版は、
+ *          4096x4096の画像で表を直接引くより遅かった (約9ms / 約5.5ms) ため用いない。srcとdstは同じ行でもよい
+ * @param src 変換元の行 (widthバイト)
+ * @param dst 変換先の行 (widthバイト)
+ * @param table 変換表 [0 256)
+ * @param width 画素数
+ */
+void convertByTable(const uint8_t *src, uint8_t *dst, const uint8_t *table, int width) {
+    for (int col = 0; col < width; col++)
+        dst[col] = table[src[col]];
+}
+
+/**
+ * @fn 0〜255に収める
+ */
+static inline int clampByte(int value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+/**
+ * @fn 24bit (B, G, R) の1行をHSVへ変換する
+ * @details V = max(R, G, B), S = 255 * (V - min) / V, Hは色相を2度単位にした 0〜179 (OpenCVの8bit画像と同じ範囲)。
+ *          無彩色 (V = min) のHは0とする。AVX2を使えるときは8画素ずつ処理する
+ * @param src 変換元の行 (3 * widthバイト)
+ * @param dst 変換先の行 (3 * widthバイト、H, S, Vの順)
+ * @param width 画素数
+ */
+void convertBgrToHsv(const uint8_t *src, uint8_t *dst, int width) {
+    //! 変換済みの画素数
+    int col = 0;
+
+#ifdef PIXEL_CONVERT_SSSE3
+    if (hasAvx2())
+        col = convertBgrToHsvAvx2(src, dst, width);
+#endif
+
+    for (; col < width; col++) {
+        int b = src[3 * col], g = src[3 * col + 1], r = src[3 * col + 2];
+        int max = b > g ? (b > r ? b : r) : (g > r ? g : r);
+        int min = b < g ? (b < r ? b : r) : (g < r ? g : r);
+        float diff = (float)(max - min);
+
+        //! 色相 (単位は2度)
+        float hue = 0.0f;
+        if (max != min) {
+            if (max == r)
+                hue = 30.0f * (float)(g - b) / diff;
+            else if (max == g)
+                hue = 60.0f + 30.0f * (float)(b - r) / diff;
+            else
+                hue = 120.0f + 30.0f * (float)(r - g) / diff;
+            if (hue < 0.0f)
+                hue += 180.0f;
+        }
+
+        int h = (int)(hue + 0.5f);
+        dst[3 * col + 0] = h == 180 ? 0 : h;
+        dst[3 * col + 1] = (int)(diff * 255.0f / (float)(max > 1 ? max : 1) + 0.5f);
+        dst[3 * col + 2] = max;
+    }
+}
+
+/**
+ * @fn 24bit (B, G, R) の1行をYCbCrへ変換する
+ * @details 係数はpixel_convert.hppを参照。AVX2を使えるときは8画素ずつ処理する
+ * @param src 変換元の行 (3 * widthバイト)
+ * @param dst 変換先の行 (3 * widthバイト、Y, Cb, Crの順)
+ * @param width 画素数
+ */
+void convertBgrToYcbcr(const uint8_t *src, uint8_t *dst, int width) {
+    //! 変換済みの画素数
+    int col = 0;
+
+#ifdef PIXEL_CONVERT_SSSE3
+    if (hasAvx2())
+        col = convertBgrToYcbcrAvx2(src, dst, width);
+#endif
+
+    for (; col < width; col++) {
+        int b = src[3 * col], g = src[3 * col + 1], r = src[3 * col + 2];
+        dst[3 * col + 0] = clampByte((YCBCR_Y_R * r + YCBCR_Y_G * g + YCBCR_Y_B * b + YCBCR_ROUND) >> 14);
+        dst[3 * col + 1] = clampByte((YCBCR_CB_R * r + YCBCR_CB_G * g + YCBCR_CB_B * b + YCBCR_OFFSET) >> 14);
+        dst[3 * col + 2] = clampByte((YCBCR_CR_R * r + YCBCR_CR_G * g + YCBCR_CR_B * b + YCBCR_OFFSET) >> 14);
+    }
+}
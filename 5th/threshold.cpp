@@ -0,0 +1,209 @@
+#include "threshold.hpp"
+#include "parallel.hpp"
+#include "point_op.hpp"
+
+using namespace std;
+
+/**
+ * @fn ヒストグラムから累積度数・累積和を求める
+ * @param hist ヒストグラム [0 256)
+ */
+OtsuThreshold::OtsuThreshold(const int *hist) {
+    long long count = 0;
+    long long sum = 0;
+
+    for (int i = 0; i < 256; i++) {
+        count += hist[i];
+        sum += (long long)i * hist[i];
+        cumCount[i] = count;
+        cumSum[i] = sum;
+    }
+}
+
+/**
+ * @fn [first, last] の画素数
+ */
+long long OtsuThreshold::countBetween(int first, int last) {
+    return cumCount[last] - (first > 0 ? cumCount[first - 1] : 0);
+}
+
+/**
+ * @fn [first, last] の画素値の合計
+ */
+long long OtsuThreshold::sumBetween(int first, int last) {
+    return cumSum[last] - (first > 0 ? cumSum[first - 1] : 0);
+}
+
+/**
+ * @fn 2値化のしきい値を求める
+ * @details 各候補iについて [0, i] と [i+1, 255] の画素数・平均を累積値から求め、
+ *          pixelNum1 * pixelNum2 * (ave1 - ave2)^2 が最大 (同じ値なら最小のi) となるiを返す
+ * @return しきい値
+ */
+int OtsuThreshold::getThreshold() {
+    //! しきい値
+    int threshold = 0;
+    //! pixelNum1 * pixelNum2 * (ave1 - ave2)^2 の最大値
+    double max = 0.0;
+
+    for (int i = 0; i < 256; ++i) {
+        long long pixelNum1 = cumCount[i];  //! クラス1の画素数
+        long long pixelNum2 = cumCount[255] - cumCount[i];  //! クラス2の画素数
+        double ave1 = 0.0;  //! クラス1の平均
+        double ave2 = 0.0;  //! クラス2の平均
+
+        if (pixelNum1)
+            ave1 = (double)cumSum[i] / pixelNum1;
+
+        if (pixelNum2)
+            ave2 = (double)(cumSum[255] - cumSum[i]) / pixelNum2;
+
+        // 分散導出
+        double tmp = ((double)pixelNum1 * pixelNum2 * (ave1 - ave2) * (ave1 - ave2));
+
+        // 最大値更新
+        if (tmp > max) {
+            max = tmp;
+            threshold = i;
+        }
+    }
+
+    return threshold;
+}
+
+/**
+ * @fn 多値化のしきい値を求める (多段階の判別分析法)
+ * @details クラス間分散の最大化は、各クラスの (合計^2 / 画素数) の和の最大化と同じになる。
+ *          区間 [u, v] ごとの 合計^2 / 画素数 を256x256の表に前計算し、
+ *          「v以下をm+1個のクラスに分けたときの最大値」を動的計画法で求める (O(count * 256^2))。
+ *          全組み合わせ (O(256^count)) を調べた結果と同じしきい値になる
+ * @param count しきい値の数 (1〜4)
+ * @return しきい値 (昇順)。t_1未満、t_1〜t_2-1、…、t_count以上 の count+1 クラスに分かれる
+ *         (各しきい値は上のクラスの最小値で、applyThresholdsでそのまま適用できる)
+ */
+vector<int> OtsuThreshold::getThresholds(int count) {
+    if (count < 1)
+        count = 1;
+    if (count > 4)
+        count = 4;
+
+    //! 区間 [u, v] の 合計^2 / 画素数 (画素がなければ0)
+    vector<double> table(256 * 256, 0.0);
+    for (int u = 0; u < 256; u++) {
+        for (int v = u; v < 256; v++) {
+            long long pixels = countBetween(u, v);
+            if (pixels > 0) {
+                double sum = (double)sumBetween(u, v);
+                table[u * 256 + v] = sum * sum / pixels;
+            }
+        }
+    }
+
+    //! best[m][v]: [0, v] をm+1個のクラスに分けたときの最大値
+    vector<vector<double>> best(count + 1, vector<double>(256, 0.0));
+    //! from[m][v]: そのときの最後のクラスの直前の値 (最後のクラスは from[m][v]+1 から始まる)
+    vector<vector<int>> from(count + 1, vector<int>(256, 0));
+
+    for (int v = 0; v < 256; v++)
+        best[0][v] = table[v];
+
+    for (int m = 1; m <= count; m++) {
+        for (int v = m; v < 256; v++) {
+            best[m][v] = -1.0;
+            for (int u = m - 1; u < v; u++) {
+                double value = best[m - 1][u] + table[(u + 1) * 256 + v];
+                if (value > best[m][v]) {
+                    best[m][v] = value;
+                    from[m][v] = u;
+                }
+            }
+        }
+    }
+
+    // 最後のクラスから順にしきい値 (各クラスの最小値) をたどる
+    vector<int> thresholds(count);
+    int last = 255;
+    for (int m = count; m >= 1; m--) {
+        thresholds[m - 1] = from[m][last] + 1;
+        last = from[m][last];
+    }
+
+    return thresholds;
+}
+
+/**
+ * @fn しきい値を用いて画像を多値化する
+ * @details 画素値以下のしきい値の数をkとして、k * 255 / しきい値の数 に置き換える。
+ *          しきい値が1個のときは、しきい値を下回れば0、それ以外は255の2値化となる。
+ *          変換表を1つ作り、1回の走査で適用する (PointOps::quantize)
+ * @param img 対象画像
+ * @param thresholds しきい値 (昇順)
+ */
+void applyThresholds(GrayImage &img, const vector<int> &thresholds) {
+    if (thresholds.empty())
+        return;
+
+    PointOps().quantize(thresholds).apply(img);
+}
+
+/**
+ * @fn 名前から適応的2値化の方法を得る
+ * @param name 名前 ("niblack", "sauvola", "bradley")
+ * @param method 格納先
+ * @return 該当する方法があればtrue
+ */
+bool parseAdaptiveMethod(string name, AdaptiveMethod &method) {
+    if (name == "niblack")
+        method = ADAPTIVE_NIBLACK;
+    else if (name == "sauvola")
+        method = ADAPTIVE_SAUVOLA;
+    else if (name == "bradley")
+        method = ADAPTIVE_BRADLEY;
+    else
+        return false;
+
+    return true;
+}
+
+/**
+ * @fn 画素ごとに周囲の平均・標準偏差からしきい値を決めて2値化する
+ * @details 積分画像を一度だけ作り、各画素の窓の平均・分散をO(1)で求める (窓の大きさによらない)。
+ *          行を分けて複数のスレッドで処理する。しきい値を下回れば0、それ以外は255とする
+ * @param img 対象画像
+ * @param method 方法
+ * @param window 窓の一辺 (奇数。偶数のときは1大きい奇数として扱う)
+ */
+void applyAdaptiveThreshold(GrayImage &img, AdaptiveMethod method, int window) {
+    IntegralImage integral;
+    integral.build(img);
+
+    //! 窓の半径
+    int radius = window / 2;
+    //! 出力先の先頭と1行あたりのバイト数 (スレッド内でgetRowを呼ばないよう先に取得)
+    uint8_t *data = img.getRow(0);
+    int stride = img.getStride();
+    int width = img.getWidth();
+
+    parallelFor(0, img.getHeight(), [&](int first, int last, int) {
+        for (int row = first; row < last; row++) {
+            //! 対象の行
+            uint8_t *line = data + (size_t)row * stride;
+
+            for (int col = 0; col < width; col++) {
+                double mean, variance;
+                integral.getWindowStats(row, col, radius, mean, variance);
+
+                //! しきい値
+                double threshold;
+                if (method == ADAPTIVE_NIBLACK)
+                    threshold = mean + NIBLACK_K * sqrt(variance);
+                else if (method == ADAPTIVE_SAUVOLA)
+                    threshold = mean * (1.0 + SAUVOLA_K * (sqrt(variance) / SAUVOLA_R - 1.0));
+                else
+                    threshold = mean * (1.0 - BRADLEY_T);
+
+                line[col] = line[col] < threshold ? 0 : 255;
+            }
+        }
+    });
+}